@@ -3,7 +3,7 @@ set(STUDENT_ID "0123456789")
 # 你的姓名
 set(STUDENT_NAME "某某某")
 
-# 实验一的完成方式："flex"或"antlr"
+# 实验一的完成方式："flex"、"antlr"或"simd"
 set(TASK1_WITH "flex")
 
 # 实验二的完成方式："bison"或"antlr"
@@ -1,7 +1,17 @@
 #include "SYsU_lang.h" // 确保这里的头文件名与您生成的词法分析器匹配
+#include "prof.hpp"
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 // 映射定义，将ANTLR的tokenTypeName映射到clang的格式
 std::unordered_map<std::string, std::string> tokenTypeMapping = {
@@ -13,104 +23,334 @@ std::unordered_map<std::string, std::string> tokenTypeMapping = {
   // 在这里继续添加其他映射
 };
 
+// 按词号直接索引的输出名，下标是词号加一（EOF 的词号是 -1）。启动时由
+// tokenTypeMapping 生成一次，输出时不再做字符串哈希。
+std::vector<std::string> gTokenNames;
+
 void
-print_token(const antlr4::Token* token,
-            const antlr4::CommonTokenStream& tokens,
-            std::ofstream& outFile,
-            const antlr4::Lexer& lexer)
+init_token_names(const antlr4::Lexer& lexer)
 {
   auto& vocabulary = lexer.getVocabulary();
 
-  auto tokenTypeName =
-    std::string(vocabulary.getSymbolicName(token->getType()));
+  gTokenNames.resize(vocabulary.getMaxTokenType() + 2);
+  for (std::size_t i = 0; i < gTokenNames.size(); ++i) {
+    auto tokenTypeName =
+      i == 0 ? std::string("EOF")
+             : std::string(vocabulary.getSymbolicName(i - 1));
 
-  if (tokenTypeName.empty())
-    tokenTypeName = "<UNKNOWN>"; // 处理可能的空字符串情况
+    if (tokenTypeName.empty())
+      tokenTypeName = "<UNKNOWN>"; // 处理可能的空字符串情况
 
-  auto mappedNameIt = tokenTypeMapping.find(tokenTypeName);
+    auto mappedNameIt = tokenTypeMapping.find(tokenTypeName);
 
-  if (mappedNameIt != tokenTypeMapping.end())
-    tokenTypeName = mappedNameIt->second;
+    if (mappedNameIt != tokenTypeMapping.end())
+      tokenTypeName = mappedNameIt->second;
 
-  auto locInfo = " Loc=<" + std::to_string(token->getLine()) + ":" +
-                 std::to_string(token->getCharPositionInLine() + 1) + ">";
+    gTokenNames[i] = std::move(tokenTypeName);
+  }
+}
 
-  bool startOfLine;
-  if (token->getText() == "<EOF>") {
-    startOfLine = false;
-  } else {
-    startOfLine =
-      (token->getCharPositionInLine() == 0) ||
-      (token->getCharPositionInLine() > 0 &&
-       tokens.get(token->getTokenIndex() - 1)->getLine() != token->getLine());
+/// 带缓冲的输出，缓冲区满了才写一次文件，数字用 to_chars 格式化，不分配内存。
+/// 写入出错后丢弃之后的输出，记下第一次失败时的 errno，由 error() 报告
+class Writer
+{
+public:
+  explicit Writer(std::FILE* file)
+    : mFile(file)
+  {
   }
 
-  bool leadingSpace = false;
-  if (token->getTokenIndex() > 0) {
-    auto prevToken = tokens.get(token->getTokenIndex() - 1);
+  ~Writer() { flush(); }
 
-    auto currentTokenLine = token->getLine();
-    auto currentTokenStartColumn = token->getCharPositionInLine();
+  Writer& operator<<(std::string_view s)
+  {
+    if (mSize + s.size() > sizeof(mBuf))
+      flush();
+    if (s.size() > sizeof(mBuf))
+      write(s.data(), s.size());
+    else {
+      std::memcpy(mBuf + mSize, s.data(), s.size());
+      mSize += s.size();
+    }
+    return *this;
+  }
 
-    auto prevTokenLine = prevToken->getLine();
+  Writer& operator<<(std::size_t n)
+  {
+    char buf[24];
+    auto end = std::to_chars(buf, buf + sizeof(buf), n).ptr;
+    return *this << std::string_view(buf, end - buf);
+  }
 
-    if (currentTokenLine != prevTokenLine && currentTokenStartColumn > 0) {
-      leadingSpace = true;
-    } else {
-      auto prevTokenStartColumn = prevToken->getCharPositionInLine();
-      auto prevTokenLength = prevToken->getText().length();
-      auto prevTokenStopColumn = prevTokenStartColumn + prevTokenLength - 1;
-
-      if (currentTokenStartColumn - prevTokenStopColumn > 1) {
-        leadingSpace = true;
-      }
-    }
+  void flush()
+  {
+    write(mBuf, mSize);
+    mSize = 0;
+  }
+
+  /// 第一次失败时的 errno，没有失败时为 0
+  int error() const { return mError; }
+
+private:
+  std::FILE* mFile;
+  char mBuf[1 << 16];
+  std::size_t mSize{ 0 };
+  int mError{ 0 };
+
+  void write(const char* data, std::size_t size)
+  {
+    if (mError != 0)
+      return;
+    errno = 0;
+    if (std::fwrite(data, 1, size, mFile) != size)
+      mError = errno ? errno : EIO;
+  }
+};
+
+/**
+ * @brief 把 ANTLR 的字符下标（码点）换算成 UTF-8 输入中的字节偏移。
+ *
+ * 词法单元按顺序到来，游标只向前移动，总开销与输入长度成正比。
+ */
+class Utf8Cursor
+{
+public:
+  explicit Utf8Cursor(std::string_view text)
+    : mText(text)
+  {
+  }
+
+  std::size_t operator()(std::size_t index)
+  {
+    for (; mIndex < index && mByte < mText.size(); ++mIndex)
+      mByte += length(mText[mByte]);
+    return mByte;
   }
 
-  if (token->getText() == "<EOF>") {
-    outFile << tokenTypeName << " ''"; // 如果是<EOF>，则不输出token的文本
-  } else {
-    outFile << tokenTypeName << " '" << token->getText()
-            << "'"; // 否则，正常输出
+private:
+  std::string_view mText;
+  std::size_t mIndex{ 0 }, mByte{ 0 };
+
+  /// 由首字节得出一个 UTF-8 字符的字节数
+  static std::size_t length(char lead)
+  {
+    auto c = static_cast<unsigned char>(lead);
+    return c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+  }
+};
+
+/**
+ * @brief 逐个输出词法分析器产生的词法单元。
+ *
+ * 只记住上一个词法单元的行号、列号和长度，不保存词法单元本身，内存占用与
+ * 词法单元的个数无关。文本直接取自输入，不调用 getText()。
+ */
+class TokenPrinter
+{
+public:
+  TokenPrinter(std::string_view source, Writer& out)
+    : mSource(source)
+    , mCursor(source)
+    , mOut(out)
+  {
   }
 
+  void operator()(const antlr4::Token& token);
+
+private:
+  std::string_view mSource;
+  Utf8Cursor mCursor;
+  Writer& mOut;
+
+  bool mHasPrev{ false };
+  std::size_t mPrevLine{ 0 }, mPrevColumn{ 0 }, mPrevLength{ 0 };
+};
+
+void
+TokenPrinter::operator()(const antlr4::Token& token)
+{
+  bool eof = token.getType() == antlr4::Token::EOF;
+  auto& tokenTypeName = gTokenNames[token.getType() + 1];
+  auto line = token.getLine();
+  auto column = token.getCharPositionInLine();
+
+  std::string_view text; // EOF 不输出文本
+  if (!eof) {
+    auto begin = mCursor(token.getStartIndex());
+    text = mSource.substr(begin, mCursor(token.getStopIndex() + 1) - begin);
+  }
+
+  bool startOfLine =
+    !eof && (column == 0 || !mHasPrev || mPrevLine != line);
+
+  bool leadingSpace = false;
+  if (mHasPrev) {
+    if (line != mPrevLine && column > 0)
+      leadingSpace = true;
+    else {
+      // 上一个词法单元的长度按字节计，与 getText().length() 一致
+      auto prevStopColumn = mPrevColumn + mPrevLength - 1;
+      leadingSpace = column - prevStopColumn > 1;
+    }
+  }
+
+  mOut << tokenTypeName << " '" << text << "'";
   if (startOfLine)
-    outFile << "\t [StartOfLine]";
+    mOut << "\t [StartOfLine]";
   if (leadingSpace)
-    outFile << " [LeadingSpace]";
-  outFile << locInfo << std::endl;
+    mOut << " [LeadingSpace]";
+  mOut << " Loc=<" << line << ":" << column + 1 << ">\n";
+
+  mHasPrev = true;
+  mPrevLine = line;
+  mPrevColumn = column;
+  mPrevLength = text.size();
 }
 
+/// 分析 inPath，结果写入 outPath，返回值与 main 的相同
 int
-main(int argc, char* argv[])
+run(const char* inPath, const char* outPath)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
-
-  std::ifstream inFile(argv[1]);
+  std::ifstream inFile(inPath);
   if (!inFile) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inPath << '\n';
     return -2;
   }
 
-  std::ofstream outFile(argv[2]);
+  auto outFile = std::fopen(outPath, "w");
   if (!outFile) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
     return -3;
   }
 
-  std::cout << "程序 '" << argv[0] << std::endl;
-  std::cout << "输入 '" << argv[1] << std::endl;
-  std::cout << "输出 '" << argv[2] << std::endl;
+  std::cout << "输入 '" << inPath << std::endl;
+  std::cout << "输出 '" << outPath << std::endl;
 
-  antlr4::ANTLRInputStream input(inFile);
+  std::string source{ std::istreambuf_iterator<char>(inFile), {} };
+  antlr4::ANTLRInputStream input(source);
   SYsU_lang lexer(&input);
 
-  antlr4::CommonTokenStream tokens(&lexer);
-  tokens.fill();
+  if (gTokenNames.empty())
+    init_token_names(lexer);
+
+  // 不经过 CommonTokenStream，词法单元用完即释放
+  int error;
+  {
+    prof::Timer timer("lex");
+    Writer out(outFile);
+    TokenPrinter print(source, out);
+    std::uint64_t count = 0;
+    for (;; ++count) {
+      auto token = lexer.nextToken();
+      print(*token);
+      if (token->getType() == antlr4::Token::EOF)
+        break;
+    }
+    prof::count("lex", "tokens", count);
+    prof::count("lex", "bytes", source.size());
+    out.flush();
+    error = out.error();
+  }
+  if (std::fclose(outFile) != 0 && error == 0)
+    error = errno;
+  if (error != 0) {
+    std::cout << "Error: unable to write output file: " << outPath << " ("
+              << std::strerror(error) << ")\n";
+    return -5;
+  }
+  return 0;
+}
+
+/// 读入列表文件，每行是以空白分隔的输入路径和输出路径，空行忽略
+std::vector<std::pair<std::string, std::string>>
+read_list(const char* path)
+{
+  std::vector<std::pair<std::string, std::string>> ret;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string in, out;
+    if (fields >> in) {
+      fields >> out;
+      ret.emplace_back(std::move(in), std::move(out));
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief 对列表中的每个输入做一遍词法分析，结果丢弃。
+ *
+ * ANTLR 生成的词法分析器把 ATN 模拟器的 DFA 缓存放在静态数据中，同一进程内的
+ * 所有实例共用，预热之后分析新文件时大多只需查表。
+ */
+void
+warmup(const char* listPath)
+{
+  auto begin = std::chrono::steady_clock::now();
+  prof::Timer timer("warmup");
+  auto list = read_list(listPath);
+  for (auto&& [in, out] : list) {
+    std::ifstream inFile(in);
+    if (!inFile)
+      continue;
+    antlr4::ANTLRInputStream input(inFile);
+    SYsU_lang lexer(&input);
+    while (lexer.nextToken()->getType() != antlr4::Token::EOF)
+      ;
+  }
+
+  std::chrono::duration<double> time =
+    std::chrono::steady_clock::now() - begin;
+  std::cout << "预热 " << list.size() << " 个文件，用时 " << time.count()
+            << " 秒" << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  // 批量模式：[--warmup <列表>] --batch <列表>，一个进程处理多个文件，ANTLR
+  // 的 DFA 缓存在文件之间保留。--time-report[=<file>] 在结束时打印各阶段的
+  // 耗时和内存，可另存为 JSON
+  const char* warmupList = nullptr;
+  const char* batchList = nullptr;
+  int i = 1;
+  for (; i < argc; ++i) {
+    if (prof::Report::global().parse_flag(argv[i]))
+      continue;
+    if (i + 1 < argc && std::strcmp(argv[i], "--warmup") == 0)
+      warmupList = argv[++i];
+    else if (i + 1 < argc && std::strcmp(argv[i], "--batch") == 0)
+      batchList = argv[++i];
+    else
+      break;
+  }
+
+  if (batchList ? i != argc : argc - i != 2) {
+    std::cout << "Usage: " << argv[0]
+              << " [--warmup <list>] [--time-report[=<file>]]"
+                 " <input> <output>\n"
+              << "       " << argv[0]
+              << " [--warmup <list>] [--time-report[=<file>]] --batch <list>\n";
+    return -1;
+  }
+
+  std::cout << "程序 '" << argv[0] << std::endl;
+  if (warmupList)
+    warmup(warmupList);
+
+  int ret = 0;
+  if (!batchList)
+    ret = run(argv[i], argv[i + 1]);
+  else {
+    for (auto&& [in, out] : read_list(batchList)) {
+      if (auto r = run(in.c_str(), out.c_str()))
+        ret = r;
+    }
+  }
 
-  for (auto&& token : tokens.getTokens())
-    print_token(token, tokens, outFile, lexer);
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
+  return ret;
 }
@@ -0,0 +1,202 @@
+#include "gen.hpp"
+#include <cstring>
+#include <iterator>
+#include <random>
+
+namespace bench {
+
+namespace {
+
+const char* kShapeNames[] = { "ident", "literal", "space", "marker", "mixed" };
+
+const char* kKeywords[] = { "int",   "char",  "const", "void",   "if",
+                            "else",  "while", "for",   "return", "break",
+                            "long",  "short", "float", "double", "sizeof",
+                            "static" };
+
+const char* kOps[] = { "+",  "-",  "*",  "/",  "%",  "<<", ">>", "<",
+                       "<=", ">",  ">=", "==", "!=", "&",  "^",  "|",
+                       "&&", "||", "=",  "+=", "-=", "->", "++", "--" };
+
+class Generator
+{
+public:
+  Generator(std::size_t size, unsigned seed)
+    : mSize(size)
+    , mRng(seed)
+  {
+    mOut.reserve(size + 256);
+  }
+
+  std::string operator()(Shape shape)
+  {
+    mOut += "# 1 \"./bench.sysu.c\"\n";
+    for (std::size_t i = 0; mOut.size() < mSize; ++i) {
+      auto s = shape == Shape::kMixed ? Shape(i % int(Shape::kMixed)) : shape;
+      switch (s) {
+        case Shape::kIdent:
+          ident_line();
+          break;
+        case Shape::kLiteral:
+          literal_line();
+          break;
+        case Shape::kSpace:
+          space_line();
+          break;
+        default:
+          marker_block();
+          break;
+      }
+    }
+    return std::move(mOut);
+  }
+
+private:
+  std::size_t mSize;
+  std::mt19937 mRng;
+  std::string mOut;
+  int mDepth{ 0 };
+
+  std::size_t pick(std::size_t n) { return mRng() % n; }
+
+  void ident()
+  {
+    static const char kHead[] =
+      "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char kTail[] =
+      "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    mOut += kHead[pick(sizeof(kHead) - 1)];
+    for (auto n = pick(24); n > 0; --n)
+      mOut += kTail[pick(sizeof(kTail) - 1)];
+  }
+
+  void number()
+  {
+    switch (pick(6)) {
+      case 0:
+        mOut += std::to_string(mRng());
+        break;
+      case 1:
+        mOut += "0x";
+        mOut += std::to_string(mRng() % 100000);
+        mOut += "abcdefABCDEF"[pick(12)];
+        mOut += "UL";
+        break;
+      case 2:
+        mOut += '0';
+        mOut += std::to_string(mRng() % 7777);
+        break;
+      case 3:
+        mOut += std::to_string(mRng() % 1000);
+        mOut += '.';
+        mOut += std::to_string(mRng() % 100000);
+        mOut += "e-12f";
+        break;
+      case 4:
+        mOut += '\'';
+        if (pick(4) == 0)
+          mOut += "\\n";
+        else
+          mOut += char('a' + pick(26));
+        mOut += '\'';
+        break;
+      default:
+        mOut += "\"";
+        for (auto n = pick(40); n > 0; --n)
+          mOut += pick(10) == 0 ? " \\\" " : "abc ";
+        mOut += "\"";
+        break;
+    }
+  }
+
+  void ident_line()
+  {
+    mOut += kKeywords[pick(std::size(kKeywords))];
+    mOut += ' ';
+    ident();
+    mOut += " = ";
+    for (auto n = 2 + pick(8); n > 0; --n) {
+      ident();
+      mOut += ' ';
+      mOut += kOps[pick(std::size(kOps))];
+      mOut += ' ';
+    }
+    ident();
+    mOut += ";\n";
+  }
+
+  void literal_line()
+  {
+    mOut += "int a[] = {";
+    for (auto n = 4 + pick(12); n > 0; --n) {
+      number();
+      mOut += ", ";
+    }
+    number();
+    mOut += "};\n";
+  }
+
+  void space_line()
+  {
+    static const char kBlanks[] = "  \t \t    \v\f";
+    for (auto n = pick(80); n > 0; --n)
+      mOut += kBlanks[pick(sizeof(kBlanks) - 1)];
+    for (auto n = pick(4); n > 0; --n)
+      mOut += '\n';
+    ident();
+    for (auto n = pick(40); n > 0; --n)
+      mOut += ' ';
+    mOut += ";\n";
+  }
+
+  std::string path(int depth)
+  {
+    if (depth == 0)
+      return "./bench.sysu.c";
+    return "./include/h" + std::to_string(depth) + ".h";
+  }
+
+  /// 模拟 #include 层层展开：进入 1 ~ 8 层头文件，每层一行代码，再逐层退出
+  void marker_block()
+  {
+    auto depth = 1 + pick(8);
+    for (std::size_t i = 0; i < depth; ++i) {
+      mOut += "# 1 \"" + path(++mDepth) + "\" 1\n";
+      ident_line();
+    }
+    for (std::size_t i = 0; i < depth; ++i) {
+      mOut += "# " + std::to_string(2 + pick(200)) + " \"" + path(--mDepth) +
+              "\" 2\n";
+      if (pick(2) == 0)
+        ident_line();
+    }
+  }
+};
+
+} // namespace
+
+bool
+parse_shape(const char* name, Shape& shape)
+{
+  for (std::size_t i = 0; i < std::size(kShapeNames); ++i) {
+    if (std::strcmp(name, kShapeNames[i]) == 0) {
+      shape = Shape(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char*
+shape_name(Shape shape)
+{
+  return kShapeNames[int(shape)];
+}
+
+std::string
+generate(Shape shape, std::size_t size, unsigned seed)
+{
+  return Generator(size, seed)(shape);
+}
+
+} // namespace bench
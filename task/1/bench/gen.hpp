@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace bench {
+
+/// 生成的源码的形态
+enum class Shape
+{
+  kIdent,   // 标识符和关键字为主
+  kLiteral, // 各种数字、字符和字符串常量为主
+  kSpace,   // 大段的空格、制表符和空行
+  kMarker,  // 频繁且层层嵌套的 # 行标记
+  kMixed,   // 以上几种轮流出现
+};
+
+/// 解析命令行中的形态名，未知的名字返回 false
+bool
+parse_shape(const char* name, Shape& shape);
+
+const char*
+shape_name(Shape shape);
+
+/**
+ * @brief 生成大约 size 字节、形如 clang -E 输出的 SYsU 源码。同样的参数总是
+ * 生成同样的内容，便于前后对比。
+ */
+std::string
+generate(Shape shape, std::size_t size, unsigned seed);
+
+} // namespace bench
@@ -0,0 +1,217 @@
+#include "SYsU_lang.h"
+#include "gen.hpp"
+#include "lex.hpp"
+#include "lex.l.hh"
+#include "scan.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void
+yyreset_offset(void); // 定义在 flex/lex.l 中
+
+/// 性能测试不输出词法分析结果，come() 每调用一次 print_token() 就计一个数
+static std::size_t sCount = 0;
+
+void
+print_token()
+{
+  ++sCount;
+}
+
+namespace {
+
+struct Result
+{
+  std::size_t mTokens{ 0 };
+  double mSeconds{ 0 };
+};
+
+using Clock = std::chrono::steady_clock;
+
+double
+since(Clock::time_point begin)
+{
+  return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+void
+reset()
+{
+  lex::gSource.clear();
+  lex::g = {};
+  sCount = 0;
+}
+
+Result
+run_flex(const std::string& src)
+{
+  reset();
+  yyreset_offset();
+
+  // flex 会改写缓冲区，并要求末尾有两个 '\0'
+  std::string buf = src;
+  buf.append(2, '\0');
+
+  auto begin = Clock::now();
+  auto state = yy_scan_buffer(buf.data(), buf.size());
+  while (yylex())
+    ;
+  yy_delete_buffer(state);
+  return { sCount, since(begin) };
+}
+
+Result
+run_simd(const std::string& src)
+{
+  reset();
+
+  // 向量指令会越过结尾读取
+  std::string buf = src;
+  buf.append(64, '\0');
+
+  auto begin = Clock::now();
+  lex::scan(buf.data(), buf.data() + src.size());
+  return { sCount, since(begin) };
+}
+
+Result
+run_antlr(const std::string& src)
+{
+  // ANTLRInputStream 会把输入转成 UTF-32，这也是 ANTLR 词法分析的一部分开销
+  auto begin = Clock::now();
+  antlr4::ANTLRInputStream input(src);
+  SYsU_lang lexer(&input);
+
+  std::size_t count = 0;
+  for (;;) {
+    auto token = lexer.nextToken();
+    ++count;
+    if (token->getType() == antlr4::Token::EOF)
+      break;
+  }
+  return { count, since(begin) };
+}
+
+/**
+ * @brief 在子进程中运行 repeat 次，取最快的一次。每个后端单独一个子进程，
+ * wait4 返回的峰值内存才只属于这个后端。
+ */
+void
+measure(const char* name,
+        Result (*run)(const std::string&),
+        const std::string& src,
+        int repeat)
+{
+  int fds[2];
+  if (pipe(fds) == -1) {
+    std::perror("pipe");
+    std::exit(-4);
+  }
+
+  auto pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Result best;
+    for (int i = 0; i < repeat; ++i) {
+      auto r = run(src);
+      if (i == 0 || r.mSeconds < best.mSeconds)
+        best = r;
+    }
+    auto ok = write(fds[1], &best, sizeof(best)) == sizeof(best);
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+
+  Result r;
+  auto ok = pid != -1 && read(fds[0], &r, sizeof(r)) == sizeof(r);
+  close(fds[0]);
+
+  struct rusage ru{};
+  int status = 0;
+  if (pid != -1)
+    wait4(pid, &status, 0, &ru);
+
+  if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::printf("  %-6s 运行失败\n", name);
+    return;
+  }
+
+  double mb = src.size() / 1048576.0;
+  std::printf("  %-6s %10zu %9.3f %13.0f %9.1f %11ld\n",
+              name,
+              r.mTokens,
+              r.mSeconds,
+              r.mTokens / r.mSeconds,
+              mb / r.mSeconds,
+              ru.ru_maxrss / 1024);
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  double sizeMb = 16;
+  int repeat = 3;
+  unsigned seed = 1;
+  bool all = true;
+  bench::Shape shape = bench::Shape::kMixed;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = argv[i];
+    auto value = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool ok = value != nullptr;
+    if (ok && std::strcmp(arg, "--size") == 0)
+      sizeMb = std::atof(value);
+    else if (ok && std::strcmp(arg, "--repeat") == 0)
+      repeat = std::max(1, std::atoi(value));
+    else if (ok && std::strcmp(arg, "--seed") == 0)
+      seed = std::atoi(value);
+    else if (ok && std::strcmp(arg, "--shape") == 0)
+      ok = (all = std::strcmp(value, "all") == 0) ||
+           bench::parse_shape(value, shape);
+    else
+      ok = false;
+
+    if (!ok) {
+      std::cout << "Usage: " << argv[0]
+                << " [--size <MiB>] [--repeat <n>] [--seed <n>]"
+                   " [--shape ident|literal|space|marker|mixed|all]\n";
+      return -1;
+    }
+    ++i;
+  }
+
+  std::vector<bench::Shape> shapes;
+  if (all) {
+    for (int s = 0; s <= int(bench::Shape::kMixed); ++s)
+      shapes.push_back(bench::Shape(s));
+  } else
+    shapes.push_back(shape);
+
+  for (auto s : shapes) {
+    auto src = bench::generate(s, std::size_t(sizeMb * 1048576), seed);
+    std::printf("形态 %s，%zu 字节，每项运行 %d 次取最快\n",
+                bench::shape_name(s),
+                src.size(),
+                repeat);
+    std::printf("  %-6s %10s %9s %13s %9s %11s\n",
+                "后端",
+                "词法单元",
+                "秒",
+                "词法单元/秒",
+                "MB/秒",
+                "峰值内存MB");
+    std::fflush(stdout);
+
+    measure("flex", run_flex, src, repeat);
+    measure("simd", run_simd, src, repeat);
+    measure("antlr", run_antlr, src, repeat);
+  }
+}
@@ -0,0 +1,191 @@
+#include "io.hpp"
+#include "lex.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace io {
+
+bool
+Writer::open(const char* path)
+{
+  mFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  mError = mFd == -1 ? errno : 0;
+  return mFd != -1;
+}
+
+bool
+Writer::close()
+{
+  if (mFd == -1)
+    return mError == 0;
+  flush();
+  if (::close(mFd) != 0 && mError == 0)
+    mError = errno;
+  mFd = -1;
+  return mError == 0;
+}
+
+void
+Writer::flush()
+{
+  // 短写时接着写剩下的部分；出错（比如磁盘满）后不再尝试，记下 errno
+  for (std::size_t done = 0; done < mLen && mError == 0;) {
+    auto n = ::write(mFd, mBuf + done, mLen - done);
+    if (n >= 0)
+      done += n;
+    else if (errno != EINTR)
+      mError = errno;
+  }
+  mLen = 0;
+}
+
+Writer&
+Writer::operator<<(std::string_view sv)
+{
+  if (mLen + sv.size() > kSize) {
+    flush();
+    if (sv.size() > kSize) {
+      for (char c : sv)
+        *this << c;
+      return *this;
+    }
+  }
+  std::memcpy(mBuf + mLen, sv.data(), sv.size());
+  mLen += sv.size();
+  return *this;
+}
+
+Writer&
+Writer::operator<<(int v)
+{
+  if (mLen + 11 > kSize) // int 最长 11 个字符
+    flush();
+  mLen = std::to_chars(mBuf + mLen, mBuf + kSize, v).ptr - mBuf;
+  return *this;
+}
+
+void
+Writer::escape(std::string_view sv)
+{
+  for (char c : sv) {
+    // 一个字符最多转义成两个字符
+    if (mLen + 2 > kSize)
+      flush();
+
+    char e;
+    switch (c) {
+      case '\n':
+        e = 'n';
+        break;
+      case '\t':
+        e = 't';
+        break;
+      case '\r':
+        e = 'r';
+        break;
+      case '\v':
+        e = 'v';
+        break;
+      case '\f':
+        e = 'f';
+        break;
+      case '\a':
+        e = 'a';
+        break;
+      case '\b':
+        e = 'b';
+        break;
+      case '\\':
+        e = '\\';
+        break;
+      case '\'':
+        e = '\'';
+        break;
+      case '\0':
+        continue;
+      default:
+        mBuf[mLen++] = c;
+        continue;
+    }
+    mBuf[mLen++] = '\\';
+    mBuf[mLen++] = e;
+  }
+}
+
+Writer gOut;
+
+char*
+map_file(const char* path, std::size_t& size)
+{
+  int fd = ::open(path, O_RDONLY);
+  if (fd == -1)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    ::close(fd);
+    return nullptr;
+  }
+  size = st.st_size;
+
+  // 先预留一段全零的匿名内存，再把文件覆盖映射到它的开头。这样即使文件大小
+  // 恰好是页大小的整数倍，末尾的 '\0' 也一定存在。
+  void* base = mmap(nullptr,
+                    size + kMapPadding,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  if (base != MAP_FAILED && size != 0 &&
+      mmap(base,
+           size,
+           PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_FIXED,
+           fd,
+           0) == MAP_FAILED) {
+    munmap(base, size + kMapPadding);
+    base = MAP_FAILED;
+  }
+
+  ::close(fd);
+  return base == MAP_FAILED ? nullptr : static_cast<char*>(base);
+}
+
+void
+unmap_file(char* buf, std::size_t size)
+{
+  munmap(buf, size + kMapPadding);
+}
+
+bool
+save_tokens(const char* path, const char* source, std::size_t size)
+{
+  std::vector<std::string_view> paths;
+  for (lex::FileId i = 0; i < lex::gSource.file_count(); ++i)
+    paths.push_back(lex::gSource.path(i));
+  return lex::gTokens->save(path, source, size, paths);
+}
+
+} // namespace io
+
+void
+print_token()
+{
+  auto& out = io::gOut;
+  out << lex::id2str(lex::g.mId) << " \'";
+  out.escape(lex::g.mText);
+  out << '\'';
+  if (lex::g.mStartOfLine)
+    out << "\t[StartOfLine]";
+  if (lex::g.mLeadingSpace)
+    out << "\t[LeadingSpace]";
+  auto loc = lex::gSource.decode(lex::g.mOffset);
+  out << "\tLoc=<" << lex::gSource.path(loc.mFile) << ':' << loc.mLine << ':'
+      << loc.mColumn << ">\n";
+}
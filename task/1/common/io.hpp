@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace io {
+
+/**
+ * @brief 带大缓冲区的输出器：攒满一整块再调用一次 write，不为每个词法单元
+ * 刷新，也不在输出过程中分配内存。写入出错后丢弃之后的输出，由 close() 的返
+ * 回值报告。
+ */
+class Writer
+{
+public:
+  ~Writer() { close(); }
+
+  bool open(const char* path);
+
+  /// 返回 false 表示写入或关闭失败，原因见 error()
+  bool close();
+
+  void flush();
+
+  /// 第一次失败时的 errno，没有失败时为 0
+  int error() const { return mError; }
+
+  Writer& operator<<(char c)
+  {
+    if (mLen == kSize)
+      flush();
+    mBuf[mLen++] = c;
+    return *this;
+  }
+
+  Writer& operator<<(std::string_view sv);
+
+  Writer& operator<<(int v);
+
+  /// 转义输出 \p sv ，直接写进缓冲区，不构造临时字符串。
+  void escape(std::string_view sv);
+
+private:
+  static constexpr std::size_t kSize = 1 << 16;
+
+  int mFd{ -1 };
+  int mError{ 0 };
+  std::size_t mLen{ 0 };
+  char mBuf[kSize];
+};
+
+/// 词法分析结果的输出文件
+extern Writer gOut;
+
+/// 映射末尾保证存在的全零字节数：flex 的 yy_scan_buffer 需要两个 '\0'，
+/// 手写的分析器一次最多越过结尾读 32 字节。
+constexpr std::size_t kMapPadding = 64;
+
+/**
+ * @brief 把整个文件映射到内存，映射末尾额外补 kMapPadding 个 '\0'。映射是私有
+ * 可写的：flex 会临时改写 yytext 之后的一个字符，但不会影响文件本身。失败时
+ * 返回 nullptr。
+ */
+char*
+map_file(const char* path, std::size_t& size);
+
+void
+unmap_file(char* buf, std::size_t size);
+
+/**
+ * @brief 把 lex::gTokens 中收集的词法单元连同路径表写成缓存文件，source 是
+ * 完整的输入内容，用于计算哈希。
+ */
+bool
+save_tokens(const char* path, const char* source, std::size_t size);
+
+} // namespace io
+
+/// 按 clang -dump-tokens 的格式输出 lex::g 中的当前词法单元
+void
+print_token();
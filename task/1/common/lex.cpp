@@ -0,0 +1,165 @@
+#include "lex.hpp"
+#include "io.hpp"
+
+namespace lex {
+
+static const char* kTokenNames[] = {
+  "identifier",   "numeric_constant",   "string_literal",
+  "sizeof",       "ptr_op",     "inc_op",
+  "dec_op",       "left_op",    "right_op",
+  "le_op",        "ge_op",      "eq_op",
+  "ne_op",        "and_op",     "or_op",
+  "mul_assign",   "div_assign", "mod_assign",
+  "add_assign",   "sub_assign", "left_assign",
+  "right_assign", "and_assign", "xor_assign",
+  "or_assign",    "type_name",  "typedef",
+  "extern",       "static",     "auto",
+  "register",     "inline",     "restrict",
+  "char",         "short",      "int",
+  "long",         "signed",     "unsigned",
+  "float",        "double",     "const",
+  "volatile",     "void",       "bool",
+  "complex",      "imaginary",  "struct",
+  "union",        "enum",       "ellipsis",
+  "case",         "default",    "if",
+  "else",         "switch",     "while",
+  "do",           "for",        "goto",
+  "continue",     "break",      "return",
+  "l_brace",      "r_brace",     "l_paren",
+  "r_paren",      "semi",        "equal",
+  "plus",         "comma",       "l_square",
+  "r_square",     "minus"
+};
+
+const char*
+id2str(Id id)
+{
+  static char sCharBuf[2] = { 0, 0 };
+  if (id == Id::YYEOF) {
+    return "eof";
+  }
+  else if (id < Id::IDENTIFIER) {
+    sCharBuf[0] = char(id);
+    return sCharBuf;
+  }
+  return kTokenNames[int(id) - int(Id::IDENTIFIER)];
+}
+
+G g;
+
+tokcache::Builder* gTokens = nullptr;
+
+/// 缓存中的词号与 task2 par.y 一致，L_BRACE 之后的记号在那里是单个字符
+static std::int32_t
+to_cache_id(Id id)
+{
+  static const char kChars[] = "{}();=+,[]-";
+  if (id >= L_BRACE)
+    return kChars[id - L_BRACE];
+  return id;
+}
+
+static void
+record_token()
+{
+  auto loc = gSource.decode(g.mOffset);
+  std::uint8_t flags = 0;
+  if (g.mStartOfLine)
+    flags |= tokcache::kStartOfLine;
+  if (g.mLeadingSpace)
+    flags |= tokcache::kLeadingSpace;
+  flags |= g.mSuffix << tokcache::kSuffixShift;
+  // flex 在文件末尾给出的文本是一个 '\0'，不属于源文件
+  std::uint32_t length = g.mId == YYEOF ? 0 : g.mText.size();
+  gTokens->push(to_cache_id(g.mId),
+                g.mOffset,
+                length,
+                loc.mFile,
+                loc.mLine,
+                loc.mColumn,
+                flags,
+                g.mValue);
+}
+
+int
+come(int tokenId, const char* yytext, int yyleng, Offset offset)
+{
+  g.mId = Id(tokenId);
+  g.mText = { yytext, std::size_t(yyleng) };
+  g.mOffset = offset;
+
+  // 常量在这里解码一次，浮点常量不解码
+  literal::Integer value;
+  if (tokenId == CONSTANT)
+    literal::decode(yytext, yyleng, value);
+  g.mValue = value.mValue;
+  g.mSuffix = value.mSuffix;
+
+  print_token();
+  if (gTokens)
+    record_token();
+  g.mStartOfLine = false;
+  g.mLeadingSpace = false;
+
+  return tokenId;
+}
+
+void
+spaces(const char* yytext, int yyleng, Offset offset)
+{
+  g.mLeadingSpace = true;
+  for (int i = 0; i < yyleng; ++i) {
+    if (yytext[i] == '\n') {
+      gSource.add_line(offset + i + 1);
+      g.mStartOfLine = true;
+      g.mLeadingSpace = false;
+    } else {
+      g.mLeadingSpace = true;
+    }
+  }
+}
+
+Marker
+parse_marker(const char* yytext)
+{
+  Marker marker;
+
+  // 手写的分析器直接在输入上调用，文本不以 '\0' 结尾，所以遇到换行也要停下。
+  // 不能用 sscanf：glibc 会先对整个剩余输入求 strlen，标记一多就成了平方复杂度
+  auto eol = [](char c) { return c == '\n' || c == '\0'; };
+  auto blank = [](char c) { return c == ' ' || c == '\t'; };
+  auto p = yytext;
+  while (blank(*p))
+    ++p;
+  if (*p == '#')
+    ++p;
+  while (blank(*p))
+    ++p;
+  if (*p >= '0' && *p <= '9') {
+    marker.mLine = 0;
+    for (; *p >= '0' && *p <= '9'; ++p)
+      marker.mLine = marker.mLine * 10 + (*p - '0');
+  }
+
+  // 路径是第一对双引号之间的内容
+  auto begin = p;
+  while (!eol(*begin) && *begin != '"')
+    ++begin;
+  if (*begin == '"') {
+    auto end = ++begin;
+    while (!eol(*end) && *end != '"')
+      ++end;
+    marker.mPath = { begin, std::size_t(end - begin) };
+  }
+
+  return marker;
+}
+
+void
+read_path(const char* yytext)
+{
+  auto marker = parse_marker(yytext);
+  gSource.add_marker(gSource.intern(marker.mPath), marker.mLine);
+}
+
+} // namespace lex
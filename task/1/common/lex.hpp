@@ -0,0 +1,218 @@
+#pragma once
+
+#include "literal.hpp"
+#include "source.hpp"
+#include "tokcache.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <cstring>
+
+namespace lex {
+
+enum Id
+{
+  YYEMPTY = -2,
+  YYEOF = 0,     /* "end of file"  */
+  YYerror = 256, /* error  */
+  YYUNDEF = 257, /* "invalid token"  */
+  IDENTIFIER,
+  CONSTANT,
+  STRING_LITERAL,
+  SIZEOF,
+  PTR_OP,
+  INC_OP,
+  DEC_OP,
+  LEFT_OP,
+  RIGHT_OP,
+  LE_OP,
+  GE_OP,
+  EQ_OP,
+  NE_OP,
+  AND_OP,
+  OR_OP,
+  MUL_ASSIGN,
+  DIV_ASSIGN,
+  MOD_ASSIGN,
+  ADD_ASSIGN,
+  SUB_ASSIGN,
+  LEFT_ASSIGN,
+  RIGHT_ASSIGN,
+  AND_ASSIGN,
+  XOR_ASSIGN,
+  OR_ASSIGN,
+  TYPE_NAME,
+  TYPEDEF,
+  EXTERN,
+  STATIC,
+  AUTO,
+  REGISTER,
+  INLINE,
+  RESTRICT,
+  CHAR,
+  SHORT,
+  INT,
+  LONG,
+  SIGNED,
+  UNSIGNED,
+  FLOAT,
+  DOUBLE,
+  CONST,
+  VOLATILE,
+  VOID,
+  BOOL,
+  COMPLEX,
+  IMAGINARY,
+  STRUCT,
+  UNION,
+  ENUM,
+  ELLIPSIS,
+  CASE,
+  DEFAULT,
+  IF,
+  ELSE,
+  SWITCH,
+  WHILE,
+  DO,
+  FOR,
+  GOTO,
+  CONTINUE,
+  BREAK,
+  RETURN,
+  L_BRACE,
+  R_BRACE,
+  L_PAREN,
+  R_PAREN,
+  SEMI,
+  EQUAL,
+  PLUS,
+  COMMA,
+  L_SQUARE,
+  R_SQUARE,
+  MINUS,
+};
+
+const char*
+id2str(Id id);
+
+/**
+ * @brief 关键字的完美哈希表。所有词法分析器都只用一条规则匹配标识符，再调用
+ * keyword() 区分关键字：一次哈希加一次比较，不分配内存。
+ *
+ * 哈希函数的系数是离线挑出来的，保证 kKeywords 中的关键字互不冲突。增删关键字
+ * 后如果下面的 static_assert 失败，需要重新挑选 hash() 中的系数。
+ */
+class KeywordTable
+{
+public:
+  struct Entry
+  {
+    std::string_view mText;
+    Id mId{ IDENTIFIER };
+  };
+
+  static constexpr Entry kKeywords[] = {
+    { "auto", AUTO },         { "_Bool", BOOL },
+    { "break", BREAK },       { "case", CASE },
+    { "char", CHAR },         { "_Complex", COMPLEX },
+    { "const", CONST },       { "continue", CONTINUE },
+    { "default", DEFAULT },   { "do", DO },
+    { "double", DOUBLE },     { "else", ELSE },
+    { "enum", ENUM },         { "extern", EXTERN },
+    { "float", FLOAT },       { "for", FOR },
+    { "goto", GOTO },         { "if", IF },
+    { "_Imaginary", IMAGINARY }, { "inline", INLINE },
+    { "int", INT },           { "long", LONG },
+    { "register", REGISTER }, { "restrict", RESTRICT },
+    { "return", RETURN },     { "short", SHORT },
+    { "signed", SIGNED },     { "sizeof", SIZEOF },
+    { "static", STATIC },     { "struct", STRUCT },
+    { "switch", SWITCH },     { "typedef", TYPEDEF },
+    { "union", UNION },       { "unsigned", UNSIGNED },
+    { "void", VOID },         { "volatile", VOLATILE },
+    { "while", WHILE },
+  };
+
+  static constexpr std::size_t kSlots = 128;
+
+  /// 只看首字符、尾字符和长度，n 必须大于 0
+  static constexpr std::size_t hash(const char* s, std::size_t n)
+  {
+    return (std::uint8_t(s[0]) * 10 + std::uint8_t(s[n - 1]) * 3 + n) &
+           (kSlots - 1);
+  }
+
+  constexpr KeywordTable()
+  {
+    for (auto&& k : kKeywords) {
+      auto& slot = mSlots[hash(k.mText.data(), k.mText.size())];
+      if (!slot.mText.empty())
+        mCollided = true;
+      slot = k;
+    }
+  }
+
+  constexpr bool collided() const { return mCollided; }
+
+  /// 如果 [s, s + n) 是关键字就返回它的词号，否则返回 IDENTIFIER
+  constexpr Id operator()(const char* s, std::size_t n) const
+  {
+    auto& slot = mSlots[hash(s, n)];
+    return slot.mText == std::string_view(s, n) ? slot.mId : IDENTIFIER;
+  }
+
+private:
+  Entry mSlots[kSlots]{};
+  bool mCollided{ false };
+};
+
+inline constexpr KeywordTable kKeyword;
+
+static_assert(!kKeyword.collided(), "关键字哈希冲突，请重新挑选哈希系数");
+
+/// 区分关键字与标识符，n 必须大于 0
+constexpr Id
+keyword(const char* s, std::size_t n)
+{
+  return kKeyword(s, n);
+}
+
+struct G
+{
+  Id mId{ YYEOF };             // 词号
+  std::string_view mText;      // 对应文本（--mmap 时直接指向输入映射）
+  Offset mOffset{ 0 };         // 在输入中的偏移，由 gSource 解码成位置
+  std::uint64_t mValue{ 0 };   // 整数或字符常量的值，其余词法单元为 0
+  literal::Suffix mSuffix{};   // 整数常量的后缀
+  bool mStartOfLine{ true };   // 是否是行首
+  bool mLeadingSpace{ false }; // 是否有前导空格
+};
+
+extern G g;
+
+/// 非空时 come() 把每个词法单元记进去，用于 --emit-tokens
+extern tokcache::Builder* gTokens;
+
+int
+come(int tokenId, const char* yytext, int yyleng, Offset offset);
+
+/// 处理从 offset 开始的一段空白，其中的换行会记入 gSource
+void
+spaces(const char* yytext, int yyleng, Offset offset);
+
+/// 预处理行标记 # <行号> "<路径>" 的内容
+struct Marker
+{
+  std::string_view mPath; // 指向标记文本中的路径
+  int mLine{ 1 };
+};
+
+/// 解析预处理行标记，不修改任何全局状态，可以在多个线程中同时调用
+Marker
+parse_marker(const char* yytext);
+
+/// 读入预处理行标记，从下一行开始生效
+void
+read_path(const char* yytext);
+
+} // namespace lex
@@ -0,0 +1,97 @@
+#include "source.hpp"
+#include <algorithm>
+
+namespace lex {
+
+SourceManager::SourceManager()
+{
+  clear();
+}
+
+void
+SourceManager::clear()
+{
+  mIds.clear();
+  mPaths.clear();
+  mLineStarts.assign(1, 0);
+  mRowCache = mMarkerCache = 0;
+
+  // 第一个行标记之前的行属于无名文件，从第 1 行算起；必须从第 0 行开始生效，
+  // 否则 find_marker 找不到标记
+  mMarkers.assign(1, Marker{ 0, intern(""), 1 });
+}
+
+FileId
+SourceManager::intern(std::string_view path)
+{
+  auto [it, inserted] = mIds.try_emplace(std::string(path), mPaths.size());
+  if (inserted)
+    mPaths.push_back(&it->first);
+  return it->second;
+}
+
+void
+SourceManager::add_marker(FileId file, int line)
+{
+  Marker marker{ std::uint32_t(mLineStarts.size()), file, line };
+  // 同一行上的多个标记只有最后一个生效
+  if (!mMarkers.empty() && mMarkers.back().mRow == marker.mRow)
+    mMarkers.back() = marker;
+  else
+    mMarkers.push_back(marker);
+}
+
+std::uint32_t
+SourceManager::find_row(Offset off) const
+{
+  auto in_row = [&](std::uint32_t row) {
+    return row < mLineStarts.size() && mLineStarts[row] <= off &&
+           (row + 1 == mLineStarts.size() || off < mLineStarts[row + 1]);
+  };
+
+  // 按顺序解码时，要么还在上次的行，要么是下一行
+  if (in_row(mRowCache))
+    return mRowCache;
+  if (in_row(mRowCache + 1))
+    return ++mRowCache;
+
+  auto it = std::upper_bound(mLineStarts.begin(), mLineStarts.end(), off);
+  return mRowCache = it - mLineStarts.begin() - 1;
+}
+
+std::uint32_t
+SourceManager::find_marker(std::uint32_t row) const
+{
+  auto in_marker = [&](std::uint32_t i) {
+    return i < mMarkers.size() && mMarkers[i].mRow <= row &&
+           (i + 1 == mMarkers.size() || row < mMarkers[i + 1].mRow);
+  };
+
+  if (in_marker(mMarkerCache))
+    return mMarkerCache;
+  if (in_marker(mMarkerCache + 1))
+    return ++mMarkerCache;
+
+  auto it = std::upper_bound(
+    mMarkers.begin(), mMarkers.end(), row, [](std::uint32_t r, auto&& m) {
+      return r < m.mRow;
+    });
+  return mMarkerCache = it - mMarkers.begin() - 1;
+}
+
+Loc
+SourceManager::decode(Offset off) const
+{
+  auto row = find_row(off);
+  auto& marker = mMarkers[find_marker(row)];
+
+  Loc loc;
+  loc.mFile = marker.mFile;
+  loc.mLine = marker.mLine + int(row - marker.mRow);
+  loc.mColumn = int(off - mLineStarts[row]) + 1;
+  return loc;
+}
+
+SourceManager gSource;
+
+} // namespace lex
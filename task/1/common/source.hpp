@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lex {
+
+/// 文件编号，每个路径只保存一次，0 号是第一个行标记之前的空路径
+using FileId = std::uint32_t;
+
+/// 词法单元在整个输入中的字节偏移
+using Offset = std::uint32_t;
+
+/// 解码后的位置
+struct Loc
+{
+  FileId mFile{ 0 };
+  int mLine{ 1 }, mColumn{ 1 };
+};
+
+/**
+ * @brief 管理输入中的位置。词法单元只记一个 Offset，需要时再通过行首表和行标记
+ * 表解码成 文件:行:列，所以位置可以随处保存而不用复制路径字符串。
+ *
+ * 词法分析器需要按偏移递增的顺序报告每个行首（add_line）和每个预处理行标记
+ * （add_marker）。decode 会缓存上次命中的行，按顺序解码时是常数时间。
+ */
+class SourceManager
+{
+public:
+  SourceManager();
+
+  /// 清空所有记录，开始分析新的输入
+  void clear();
+
+  FileId intern(std::string_view path);
+
+  const std::string& path(FileId file) const { return *mPaths[file]; }
+
+  std::size_t file_count() const { return mPaths.size(); }
+
+  /// 记录一个新行从 off 开始
+  void add_line(Offset off) { mLineStarts.push_back(off); }
+
+  /// 记录下一个新行是 file 的第 line 行
+  void add_marker(FileId file, int line);
+
+  Loc decode(Offset off) const;
+
+private:
+  struct Marker
+  {
+    std::uint32_t mRow; // 生效的物理行号，从 0 开始
+    FileId mFile;
+    int mLine;
+  };
+
+  std::unordered_map<std::string, FileId> mIds;
+  std::vector<const std::string*> mPaths; // 指向 mIds 中的键，地址不会变
+  std::vector<Offset> mLineStarts;        // 每个物理行的起始偏移
+  std::vector<Marker> mMarkers;           // 按 mRow 递增
+
+  mutable std::uint32_t mRowCache{ 0 };
+  mutable std::uint32_t mMarkerCache{ 0 };
+
+  std::uint32_t find_row(Offset off) const;
+
+  std::uint32_t find_marker(std::uint32_t row) const;
+};
+
+extern SourceManager gSource;
+
+} // namespace lex
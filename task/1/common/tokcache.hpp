@@ -0,0 +1,239 @@
+#pragma once
+
+// 实验一与实验二共用的二进制词法单元缓存格式。task/1/common/tokcache.hpp 与
+// task/2/bison/tokcache.hpp 是同一份文件，修改时请同步。
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tokcache {
+
+/**
+ * @brief 文件布局（所有整数都是本机字节序）：
+ *
+ *   Header
+ *   std::uint64_t value[mCount]   整数或字符常量的值，其余词法单元为 0
+ *   std::int32_t  id[mCount]      词号，与 task2 par.y 一致，单字符记号即字符
+ *   std::uint32_t offset[mCount]  在源文件中的字节偏移
+ *   std::uint32_t length[mCount]  文本长度
+ *   std::uint32_t file[mCount]    所在文件在路径表中的下标
+ *   std::uint32_t line[mCount]    行号
+ *   std::uint32_t column[mCount]  列号
+ *   std::uint8_t  flags[mCount]   Flag 的组合与常量后缀，末尾补齐到 4 字节
+ *   std::uint32_t pathEnd[mPathCount]  每个路径在路径字节中的结束位置
+ *   char          pathBytes[mPathBytes]
+ *
+ * 每个数组都从 4 字节对齐的位置开始（value 从 8 字节对齐的位置开始），映射到
+ * 内存后可以直接当数组用。
+ */
+struct Header
+{
+  char mMagic[8];
+  std::uint32_t mVersion;
+  std::uint32_t mCount;
+  std::uint64_t mSourceHash; // 源文件内容的 FNV-1a 哈希
+  std::uint64_t mSourceSize;
+  std::uint32_t mPathCount;
+  std::uint32_t mPathBytes;
+};
+
+static_assert(sizeof(Header) % 8 == 0, "value 数组需要 8 字节对齐");
+
+constexpr char kMagic[8] = "SYsUtok";
+constexpr std::uint32_t kVersion = 2;
+
+enum Flag : std::uint8_t
+{
+  kStartOfLine = 1,
+  kLeadingSpace = 2,
+};
+
+/// flags 的高位是整数常量的后缀，即 literal::Suffix 左移 kSuffixShift 位
+constexpr int kSuffixShift = 2;
+
+inline std::uint64_t
+hash(const char* data, std::size_t size)
+{
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < size; ++i) {
+    h ^= std::uint8_t(data[i]);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+inline std::size_t
+align4(std::size_t n)
+{
+  return (n + 3) & ~std::size_t(3);
+}
+
+/// 在内存中逐个收集词法单元，最后一次写出
+class Builder
+{
+public:
+  void push(std::int32_t id,
+            std::uint32_t offset,
+            std::uint32_t length,
+            std::uint32_t file,
+            std::uint32_t line,
+            std::uint32_t column,
+            std::uint8_t flags,
+            std::uint64_t value)
+  {
+    mValue.push_back(value);
+    mId.push_back(id);
+    mOffset.push_back(offset);
+    mLength.push_back(length);
+    mFile.push_back(file);
+    mLine.push_back(line);
+    mColumn.push_back(column);
+    mFlags.push_back(flags);
+  }
+
+  /// 路径按下标顺序给出，下标即 push 时的 file
+  bool save(const char* path,
+            const char* source,
+            std::size_t sourceSize,
+            const std::vector<std::string_view>& paths) const
+  {
+    Header header{};
+    std::memcpy(header.mMagic, kMagic, sizeof(kMagic));
+    header.mVersion = kVersion;
+    header.mCount = mId.size();
+    header.mSourceHash = hash(source, sourceSize);
+    header.mSourceSize = sourceSize;
+    header.mPathCount = paths.size();
+
+    std::vector<std::uint32_t> pathEnd;
+    std::string pathBytes;
+    for (auto&& p : paths) {
+      pathBytes += p;
+      pathEnd.push_back(pathBytes.size());
+    }
+    header.mPathBytes = pathBytes.size();
+
+    auto file = std::fopen(path, "wb");
+    if (!file)
+      return false;
+
+    auto put = [file](const void* data, std::size_t size) {
+      return std::fwrite(data, 1, size, file) == size;
+    };
+    static const char kZeros[4] = {};
+
+    bool ok = put(&header, sizeof(header)) &&
+              put(mValue.data(), mValue.size() * sizeof(mValue[0])) &&
+              put(mId.data(), mId.size() * sizeof(mId[0])) &&
+              put(mOffset.data(), mOffset.size() * sizeof(mOffset[0])) &&
+              put(mLength.data(), mLength.size() * sizeof(mLength[0])) &&
+              put(mFile.data(), mFile.size() * sizeof(mFile[0])) &&
+              put(mLine.data(), mLine.size() * sizeof(mLine[0])) &&
+              put(mColumn.data(), mColumn.size() * sizeof(mColumn[0])) &&
+              put(mFlags.data(), mFlags.size()) &&
+              put(kZeros, align4(mFlags.size()) - mFlags.size()) &&
+              put(pathEnd.data(), pathEnd.size() * sizeof(pathEnd[0])) &&
+              put(pathBytes.data(), pathBytes.size());
+
+    return std::fclose(file) == 0 && ok;
+  }
+
+private:
+  std::vector<std::uint64_t> mValue;
+  std::vector<std::int32_t> mId;
+  std::vector<std::uint32_t> mOffset, mLength, mFile, mLine, mColumn;
+  std::vector<std::uint8_t> mFlags;
+};
+
+/// 映射在内存中的缓存，只做校验和下标访问，不复制任何数据
+class View
+{
+public:
+  /// 校验 [data, data + size) 是否是 source 的缓存，失败时返回 false
+  bool bind(const char* data,
+            std::size_t size,
+            const char* source,
+            std::size_t sourceSize)
+  {
+    if (size < sizeof(Header))
+      return false;
+    auto& header = *reinterpret_cast<const Header*>(data);
+    if (std::memcmp(header.mMagic, kMagic, sizeof(kMagic)) != 0 ||
+        header.mVersion != kVersion || header.mSourceSize != sourceSize)
+      return false;
+
+    std::size_t n = header.mCount;
+    std::size_t need = sizeof(Header) + n * 8 + n * 4 * 6 + align4(n) +
+                       std::size_t(header.mPathCount) * 4 + header.mPathBytes;
+    if (size != need)
+      return false;
+
+    // 大小对得上才计算哈希，这是最慢的一步
+    if (header.mSourceHash != hash(source, sourceSize))
+      return false;
+
+    auto p = data + sizeof(Header);
+    auto take = [&p](std::size_t bytes) {
+      auto ret = p;
+      p += bytes;
+      return ret;
+    };
+    mCount = n;
+    mValue = reinterpret_cast<const std::uint64_t*>(take(n * 8));
+    mId = reinterpret_cast<const std::int32_t*>(take(n * 4));
+    mOffset = reinterpret_cast<const std::uint32_t*>(take(n * 4));
+    mLength = reinterpret_cast<const std::uint32_t*>(take(n * 4));
+    mFile = reinterpret_cast<const std::uint32_t*>(take(n * 4));
+    mLine = reinterpret_cast<const std::uint32_t*>(take(n * 4));
+    mColumn = reinterpret_cast<const std::uint32_t*>(take(n * 4));
+    mFlags = reinterpret_cast<const std::uint8_t*>(take(align4(n)));
+    mPathCount = header.mPathCount;
+    mPathEnd = reinterpret_cast<const std::uint32_t*>(take(mPathCount * 4));
+    mPathBytes = take(header.mPathBytes);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      if (mFile[i] >= mPathCount ||
+          std::size_t(mOffset[i]) + mLength[i] > sourceSize)
+        return false;
+    }
+    for (std::size_t i = 0; i < mPathCount; ++i) {
+      if (mPathEnd[i] > header.mPathBytes ||
+          (i > 0 && mPathEnd[i] < mPathEnd[i - 1]))
+        return false;
+    }
+    return true;
+  }
+
+  std::size_t size() const { return mCount; }
+
+  std::uint64_t value(std::size_t i) const { return mValue[i]; }
+  std::int32_t id(std::size_t i) const { return mId[i]; }
+  std::uint32_t offset(std::size_t i) const { return mOffset[i]; }
+  std::uint32_t length(std::size_t i) const { return mLength[i]; }
+  std::uint32_t file(std::size_t i) const { return mFile[i]; }
+  std::uint32_t line(std::size_t i) const { return mLine[i]; }
+  std::uint32_t column(std::size_t i) const { return mColumn[i]; }
+  std::uint8_t flags(std::size_t i) const { return mFlags[i]; }
+
+  std::string_view path(std::uint32_t file) const
+  {
+    std::uint32_t begin = file == 0 ? 0 : mPathEnd[file - 1];
+    return { mPathBytes + begin, mPathEnd[file] - begin };
+  }
+
+private:
+  std::size_t mCount{ 0 }, mPathCount{ 0 };
+  const std::uint64_t* mValue{ nullptr };
+  const std::int32_t* mId{ nullptr };
+  const std::uint32_t *mOffset{ nullptr }, *mLength{ nullptr },
+    *mFile{ nullptr }, *mLine{ nullptr }, *mColumn{ nullptr };
+  const std::uint8_t* mFlags{ nullptr };
+  const std::uint32_t* mPathEnd{ nullptr };
+  const char* mPathBytes{ nullptr };
+};
+
+} // namespace tokcache
@@ -1,94 +1,125 @@
+#include "io.hpp"
 #include "lex.hpp"
 #include "lex.l.hh"
-#include <fstream>
+#include "prof.hpp"
+#include <chrono>
+#include <cstring>
 #include <iostream>
-
-static std::ofstream outFile;
-
-static std::string
-escape(std::string_view sv)
-{
-  std::string result;
-  for (char c : sv) {
-    switch (c) {
-      case '\n':
-        result += "\\n";
-        break;
-      case '\t':
-        result += "\\t";
-        break;
-      case '\r':
-        result += "\\r";
-        break;
-      case '\v':
-        result += "\\v";
-        break;
-      case '\f':
-        result += "\\f";
-        break;
-      case '\a':
-        result += "\\a";
-        break;
-      case '\b':
-        result += "\\b";
-        break;
-      case '\\':
-        result += "\\\\";
-        break;
-      case '\'':
-        result += "\\\'";
-        break;
-      case '\0':
-        break;
-      default:
-        result += c;
-        break;
-    }
-  }
-  return result;
-}
-
-void
-print_token()
-{
-  outFile << lex::id2str(lex::g.mId) << " \'" << escape(lex::g.mText) << "\'";
-  if (lex::g.mStartOfLine)
-    outFile << "\t[StartOfLine]";
-  if (lex::g.mLeadingSpace)
-    outFile << "\t[LeadingSpace]";
-  outFile << "\tLoc=<" << lex::g.mFile << ':' << lex::g.mLine << ':'
-          << lex::g.mColumn - yyleng << ">\n";
-  outFile << std::flush;
-}
+#include <sys/stat.h>
 
 int
 main(int argc, char* argv[])
 {
+  auto prog = argv[0];
+
+  // --mmap：把输入文件整个映射到内存，flex 直接在映射上做词法分析
+  // --emit-tokens <cache>：另外把词法单元写成二进制缓存，实验二可以直接读入
+  // --time-report[=<file>]：结束时打印各阶段的耗时和内存，可另存为 JSON
+  bool useMmap = false;
+  const char* cachePath = nullptr;
+  while (argc > 3) {
+    if (std::strcmp(argv[1], "--mmap") == 0)
+      useMmap = true;
+    else if (std::strcmp(argv[1], "--emit-tokens") == 0 && argc > 4) {
+      cachePath = argv[2];
+      ++argv, --argc;
+    } else if (!prof::Report::global().parse_flag(argv[1]))
+      break;
+    ++argv, --argc;
+  }
+
   if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
+    std::cout << "Usage: " << prog
+              << " [--mmap] [--emit-tokens <cache>] [--time-report[=<file>]]"
+                 " <input> <output>\n";
     return -1;
   }
 
-  yyin = fopen(argv[1], "r");
-  if (!yyin) {
-    std::cerr << "Failed to open " << argv[1] << '\n';
-    return -2;
+  std::size_t inSize = 0;
+  char* inBuf = nullptr;
+  YY_BUFFER_STATE inState = nullptr;
+
+  if (useMmap) {
+    inBuf = io::map_file(argv[1], inSize);
+    if (inBuf)
+      inState = yy_scan_buffer(inBuf, inSize + 2);
+    if (!inState) {
+      std::cerr << "Failed to open " << argv[1] << '\n';
+      return -2;
+    }
+  }
+
+  else {
+    yyin = fopen(argv[1], "r");
+    if (!yyin) {
+      std::cerr << "Failed to open " << argv[1] << '\n';
+      return -2;
+    }
+
+    struct stat st;
+    if (fstat(fileno(yyin), &st) == 0)
+      inSize = st.st_size;
   }
 
-  outFile = std::ofstream(argv[2]);
-  if (!outFile) {
+  if (!io::gOut.open(argv[2])) {
     std::cerr << "Failed to open " << argv[2] << '\n';
     return -3;
   }
 
-  std::cout << "程序 '" << argv[0] << std::endl;
+  std::cout << "程序 '" << prog << std::endl;
   std::cout << "输入 '" << argv[1] << std::endl;
   std::cout << "输出 '" << argv[2] << std::endl;
 
+  tokcache::Builder tokens;
+  if (cachePath)
+    lex::gTokens = &tokens;
+
+  auto begin = std::chrono::steady_clock::now();
+  prof::Timer lexTimer("lex");
+
   // 这个循环完成词法分析，yylex()中会调用print_token()，从而向
   // 输出文件中写入词法分析结果。
   while (yylex())
     ;
 
-  fclose(yyin);
+  lexTimer.stop();
+  prof::count("lex", "bytes", inSize);
+  std::chrono::duration<double> secs = std::chrono::steady_clock::now() - begin;
+  std::cout << "模式 " << (useMmap ? "mmap" : "fopen") << "，共 " << inSize
+            << " 字节，用时 " << secs.count() << " 秒，吞吐 "
+            << (secs.count() > 0 ? inSize / secs.count() : 0) << " 字节/秒"
+            << std::endl;
+
+  bool written;
+  {
+    prof::Timer timer("output");
+    written = io::gOut.close();
+  }
+  if (!written) {
+    std::cerr << "Failed to write " << argv[2] << ": "
+              << std::strerror(io::gOut.error()) << '\n';
+    return -5;
+  }
+
+  if (cachePath) {
+    prof::Timer timer("emit-tokens");
+    // fopen 模式下没有整个文件的内容，单独映射一次用于计算哈希
+    std::size_t srcSize = inSize;
+    char* src = useMmap ? inBuf : io::map_file(argv[1], srcSize);
+    if (!src || !io::save_tokens(cachePath, src, srcSize)) {
+      std::cerr << "Failed to write " << cachePath << '\n';
+      return -4;
+    }
+    if (!useMmap)
+      io::unmap_file(src, srcSize);
+  }
+
+  if (useMmap) {
+    yy_delete_buffer(inState);
+    io::unmap_file(inBuf, inSize);
+  } else
+    fclose(yyin);
+
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
 }
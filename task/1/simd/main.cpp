@@ -0,0 +1,168 @@
+#include "io.hpp"
+#include "lex.hpp"
+#include "prof.hpp"
+#include "scan.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+static_assert(io::kMapPadding >= lex::kReadAhead, "映射末尾补齐的字节不够");
+
+/**
+ * @brief relex() 的自检：在输入上依次做 rounds 次随机的小修改，每次都把
+ * relex() 更新后的数组与对修改后的输入重新 tokenize() 的结果比较。
+ */
+static bool
+relex_check(const char* buf, std::size_t size, unsigned rounds)
+{
+  // 插入的片段有意包含会改变前后词法单元的字符：引号、注释、行标记、续行
+  static const char* const kPieces[] = {
+    "x",  " ",  "\n", "\"", "'",  "12",  ".5e",      "# 3 \"f.c\"\n",
+    "/*", "*/", "L",  "<%", ">>=", "\\", "  \n\n ", "int",
+  };
+
+  std::mt19937 rng(42);
+  std::string text(buf, size), padded;
+  auto pad = [&] {
+    padded = text;
+    padded.append(lex::kReadAhead, '\0');
+  };
+
+  pad();
+  auto tokens = lex::tokenize(
+    padded.data(), padded.data() + text.size(), padded.size());
+  std::size_t relexed = 0;
+  for (unsigned i = 0; i < rounds; ++i) {
+    lex::Edit edit;
+    edit.mOffset = rng() % (text.size() + 1);
+    edit.mRemoved =
+      std::min<std::size_t>(rng() % 6, text.size() - edit.mOffset);
+    std::string ins;
+    for (auto n = rng() % 3; n > 0; --n)
+      ins += kPieces[rng() % std::size(kPieces)];
+    edit.mInserted = ins.size();
+    text.replace(edit.mOffset, edit.mRemoved, ins);
+
+    pad();
+    auto end = padded.data() + text.size();
+    auto range = lex::relex(tokens, padded.data(), end, padded.size(), edit);
+    relexed += range.mEnd - range.mBegin;
+    if (tokens != lex::tokenize(padded.data(), end, padded.size())) {
+      std::cerr << "relex 自检失败：第 " << i + 1 << " 次修改，位置 "
+                << edit.mOffset << "，删除 " << edit.mRemoved << "，插入 '"
+                << ins << "'\n";
+      return false;
+    }
+  }
+
+  std::cout << "relex 自检通过：" << rounds << " 次修改，平均每次重新分析 "
+            << (rounds ? double(relexed) / rounds : 0) << " 个词法单元"
+            << std::endl;
+  return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+  auto prog = argv[0];
+
+  // --emit-tokens <cache>：另外把词法单元写成二进制缓存，实验二可以直接读入
+  // --jobs <n>：把输入切成块，用 n 个线程并行分析，输出与单线程完全相同
+  // --time-report[=<file>]：结束时打印各阶段的耗时和内存，可另存为 JSON
+  // --relex-check <n>：输出之后再在输入上做 n 次随机修改，检查 relex()
+  const char* cachePath = nullptr;
+  unsigned jobs = 1, relexRounds = 0;
+  while (argc > 3) {
+    if (prof::Report::global().parse_flag(argv[1])) {
+      ++argv, --argc;
+      continue;
+    }
+    if (argc > 4 && std::strcmp(argv[1], "--emit-tokens") == 0)
+      cachePath = argv[2];
+    else if (argc > 4 && std::strcmp(argv[1], "--jobs") == 0)
+      jobs = std::max(1, std::atoi(argv[2]));
+    else if (argc > 4 && std::strcmp(argv[1], "--relex-check") == 0)
+      relexRounds = std::max(0, std::atoi(argv[2]));
+    else
+      break;
+    argv += 2, argc -= 2;
+  }
+
+  if (argc != 3) {
+    std::cout << "Usage: " << prog
+              << " [--emit-tokens <cache>] [--jobs <n>] [--relex-check <n>]"
+                 " [--time-report[=<file>]] <input> <output>\n";
+    return -1;
+  }
+
+  std::size_t inSize = 0;
+  char* inBuf = io::map_file(argv[1], inSize);
+  if (!inBuf) {
+    std::cerr << "Failed to open " << argv[1] << '\n';
+    return -2;
+  }
+
+  if (!io::gOut.open(argv[2])) {
+    std::cerr << "Failed to open " << argv[2] << '\n';
+    return -3;
+  }
+
+  std::cout << "程序 '" << prog << std::endl;
+  std::cout << "输入 '" << argv[1] << std::endl;
+  std::cout << "输出 '" << argv[2] << std::endl;
+
+  tokcache::Builder tokens;
+  if (cachePath)
+    lex::gTokens = &tokens;
+
+  auto begin = std::chrono::steady_clock::now();
+  prof::Timer lexTimer("lex");
+
+  // 扫描整个映射，每个词法单元都会经 come() 调用 print_token()
+  if (jobs > 1)
+    lex::scan_parallel(inBuf, inBuf + inSize, jobs);
+  else
+    lex::scan(inBuf, inBuf + inSize);
+
+  lexTimer.stop();
+  prof::count("lex", "bytes", inSize);
+  std::chrono::duration<double> secs = std::chrono::steady_clock::now() - begin;
+  std::cout << "模式 simd（" << jobs << " 线程），共 " << inSize
+            << " 字节，用时 " << secs.count() << " 秒，吞吐 "
+            << (secs.count() > 0 ? inSize / secs.count() : 0) << " 字节/秒"
+            << std::endl;
+
+  bool written;
+  {
+    prof::Timer timer("output");
+    written = io::gOut.close();
+  }
+  if (!written) {
+    std::cerr << "Failed to write " << argv[2] << ": "
+              << std::strerror(io::gOut.error()) << '\n';
+    return -5;
+  }
+
+  if (cachePath) {
+    prof::Timer timer("emit-tokens");
+    if (!io::save_tokens(cachePath, inBuf, inSize)) {
+      std::cerr << "Failed to write " << cachePath << '\n';
+      return -4;
+    }
+  }
+
+  if (relexRounds) {
+    prof::Timer timer("relex-check");
+    if (!relex_check(inBuf, inSize, relexRounds))
+      return -6;
+  }
+
+  io::unmap_file(inBuf, inSize);
+
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
+}
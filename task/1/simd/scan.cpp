@@ -0,0 +1,895 @@
+#include "scan.hpp"
+#include "lex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+namespace lex {
+
+namespace {
+
+//==============================================================================
+// 字符分类
+//==============================================================================
+
+enum : std::uint8_t
+{
+  kIdent = 1, // [a-zA-Z_0-9]
+  kDigit = 2, // [0-9]
+  kHex = 4,   // [a-fA-F0-9]
+  kOct = 8,   // [0-7]
+  kBlank = 16 // [ \t\v\n\f]
+};
+
+struct CharTable
+{
+  std::uint8_t mFlags[256]{};
+
+  constexpr CharTable()
+  {
+    for (int c = 'a'; c <= 'z'; ++c)
+      mFlags[c] = mFlags[c - 'a' + 'A'] = kIdent;
+    mFlags['_'] = kIdent;
+    for (int c = '0'; c <= '9'; ++c)
+      mFlags[c] = kIdent | kDigit | kHex | (c <= '7' ? kOct : 0);
+    for (int c = 'a'; c <= 'f'; ++c) {
+      mFlags[c] |= kHex;
+      mFlags[c - 'a' + 'A'] |= kHex;
+    }
+    for (char c : { ' ', '\t', '\v', '\n', '\f' })
+      mFlags[std::uint8_t(c)] = kBlank;
+  }
+
+  bool operator()(char c, std::uint8_t flag) const
+  {
+    return mFlags[std::uint8_t(c)] & flag;
+  }
+};
+
+constexpr CharTable kIs;
+
+/// 一段空白的扫描结果
+struct Blank
+{
+  const char* mEnd;    // 空白之后的第一个字符
+  int mLines;          // 其中换行符的个数
+  const char* mLastNl; // 最后一个换行符，没有换行时无意义
+};
+
+#ifndef SCAN_X86
+
+//==============================================================================
+// 标量实现，非 x86 平台上使用
+//==============================================================================
+
+const char*
+scalar_class_end(const char* p, const char* end, std::uint8_t flag)
+{
+  while (p < end && kIs(*p, flag))
+    ++p;
+  return p;
+}
+
+const char*
+scalar_ident_end(const char* p, const char* end)
+{
+  return scalar_class_end(p, end, kIdent);
+}
+
+const char*
+scalar_digit_end(const char* p, const char* end)
+{
+  return scalar_class_end(p, end, kDigit);
+}
+
+Blank
+scalar_blank_end(const char* p, const char* end)
+{
+  Blank ret{ end, 0, nullptr };
+  for (; p < end && kIs(*p, kBlank); ++p) {
+    if (*p == '\n') {
+      ++ret.mLines;
+      ret.mLastNl = p;
+    }
+  }
+  ret.mEnd = p;
+  return ret;
+}
+
+const char*
+scalar_quote_end(const char* p, const char* end, char quote)
+{
+  while (p < end && *p != quote && *p != '\\' && *p != '\n')
+    ++p;
+  return p;
+}
+
+#else
+
+//==============================================================================
+// SSE2 实现，一次 16 字节
+//==============================================================================
+
+/// 把 p 处第一个被 stop 标记的字节转成指针，不越过 end
+inline const char*
+first_stop(const char* p, const char* end, std::uint32_t stop)
+{
+  auto ret = p + __builtin_ctz(stop);
+  return ret < end ? ret : end;
+}
+
+inline __m128i
+sse2_in(__m128i v, char lo, char hi)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(lo - 1))),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(char(hi + 1))));
+}
+
+const char*
+sse2_ident_end(const char* p, const char* end)
+{
+  for (; p < end; p += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    auto m = _mm_or_si128(
+      _mm_or_si128(sse2_in(lower, 'a', 'z'), sse2_in(v, '0', '9')),
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    std::uint32_t stop = ~_mm_movemask_epi8(m) & 0xFFFF;
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+const char*
+sse2_digit_end(const char* p, const char* end)
+{
+  for (; p < end; p += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    std::uint32_t stop = ~_mm_movemask_epi8(sse2_in(v, '0', '9')) & 0xFFFF;
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+Blank
+sse2_blank_end(const char* p, const char* end)
+{
+  Blank ret{ end, 0, nullptr };
+  for (; p < end; p += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                           sse2_in(v, '\t', '\f'));
+    std::uint32_t stop = ~_mm_movemask_epi8(ws) & 0xFFFF;
+    std::uint32_t nl =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+
+    auto n = std::min<std::ptrdiff_t>(stop ? __builtin_ctz(stop) : 16, end - p);
+    nl &= (1u << n) - 1;
+    if (nl) {
+      ret.mLines += __builtin_popcount(nl);
+      ret.mLastNl = p + 31 - __builtin_clz(nl);
+    }
+    if (n < 16) {
+      ret.mEnd = p + n;
+      return ret;
+    }
+  }
+  return ret;
+}
+
+const char*
+sse2_quote_end(const char* p, const char* end, char quote)
+{
+  auto q = _mm_set1_epi8(quote);
+  auto bs = _mm_set1_epi8('\\');
+  auto nl = _mm_set1_epi8('\n');
+  for (; p < end; p += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto m = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, q), _mm_cmpeq_epi8(v, bs)),
+      _mm_cmpeq_epi8(v, nl));
+    std::uint32_t stop = _mm_movemask_epi8(m);
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+//==============================================================================
+// AVX2 实现，一次 32 字节，运行时检测到 CPU 支持才使用
+//==============================================================================
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 inline __m256i
+avx2_in(__m256i v, char lo, char hi)
+{
+  return _mm256_and_si256(
+    _mm256_cmpgt_epi8(v, _mm256_set1_epi8(char(lo - 1))),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8(char(hi + 1)), v));
+}
+
+SCAN_AVX2 const char*
+avx2_ident_end(const char* p, const char* end)
+{
+  for (; p < end; p += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    auto m = _mm256_or_si256(
+      _mm256_or_si256(avx2_in(lower, 'a', 'z'), avx2_in(v, '0', '9')),
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    std::uint32_t stop = ~std::uint32_t(_mm256_movemask_epi8(m));
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+SCAN_AVX2 const char*
+avx2_digit_end(const char* p, const char* end)
+{
+  for (; p < end; p += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    std::uint32_t stop =
+      ~std::uint32_t(_mm256_movemask_epi8(avx2_in(v, '0', '9')));
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+SCAN_AVX2 Blank
+avx2_blank_end(const char* p, const char* end)
+{
+  Blank ret{ end, 0, nullptr };
+  for (; p < end; p += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                              avx2_in(v, '\t', '\f'));
+    std::uint32_t stop = ~std::uint32_t(_mm256_movemask_epi8(ws));
+    std::uint32_t nl =
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+
+    auto n = std::min<std::ptrdiff_t>(stop ? __builtin_ctz(stop) : 32, end - p);
+    if (n < 32)
+      nl &= (1u << n) - 1;
+    if (nl) {
+      ret.mLines += __builtin_popcount(nl);
+      ret.mLastNl = p + 31 - __builtin_clz(nl);
+    }
+    if (n < 32) {
+      ret.mEnd = p + n;
+      return ret;
+    }
+  }
+  return ret;
+}
+
+SCAN_AVX2 const char*
+avx2_quote_end(const char* p, const char* end, char quote)
+{
+  auto q = _mm256_set1_epi8(quote);
+  auto bs = _mm256_set1_epi8('\\');
+  auto nl = _mm256_set1_epi8('\n');
+  for (; p < end; p += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto m = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, q), _mm256_cmpeq_epi8(v, bs)),
+      _mm256_cmpeq_epi8(v, nl));
+    std::uint32_t stop = _mm256_movemask_epi8(m);
+    if (stop)
+      return first_stop(p, end, stop);
+  }
+  return end;
+}
+
+#undef SCAN_AVX2
+
+#endif
+
+/// 当前 CPU 上使用的一组实现
+struct Kernels
+{
+  const char* (*mIdentEnd)(const char*, const char*);
+  const char* (*mDigitEnd)(const char*, const char*);
+  Blank (*mBlankEnd)(const char*, const char*);
+  const char* (*mQuoteEnd)(const char*, const char*, char);
+};
+
+Kernels
+pick_kernels()
+{
+#ifdef SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return { avx2_ident_end, avx2_digit_end, avx2_blank_end, avx2_quote_end };
+  return { sse2_ident_end, sse2_digit_end, sse2_blank_end, sse2_quote_end };
+#else
+  return {
+    scalar_ident_end, scalar_digit_end, scalar_blank_end, scalar_quote_end
+  };
+#endif
+}
+
+const Kernels kKernels = pick_kernels();
+
+//==============================================================================
+// 数字常量，对应 lex.l 中所有 CONSTANT 规则的最长匹配
+//==============================================================================
+
+/// 从 p 开始连续属于 flag 类的字符数
+std::size_t
+run(const char* p, std::uint8_t flag)
+{
+  std::size_t n = 0;
+  while (kIs(p[n], flag))
+    ++n;
+  return n;
+}
+
+/// IS    ((u|U)|(u|U)?(l|L|ll|LL)|(l|L|ll|LL)(u|U))
+std::size_t
+match_is(const char* p)
+{
+  auto is_u = [](char c) { return c == 'u' || c == 'U'; };
+  auto is_l = [](char c) { return c == 'l' || c == 'L'; };
+
+  std::size_t n = 0;
+  if (is_u(p[0])) {
+    n = 1;
+    if (is_l(p[1]))
+      n = p[2] == p[1] ? 3 : 2;
+  } else if (is_l(p[0])) {
+    n = p[1] == p[0] ? 2 : 1;
+    if (is_u(p[n]))
+      ++n;
+  }
+  return n;
+}
+
+/// FS    (f|F|l|L)
+std::size_t
+match_fs(const char* p)
+{
+  auto c = *p;
+  return c == 'f' || c == 'F' || c == 'l' || c == 'L';
+}
+
+/// E     ([Ee][+-]?{D}+) 或 P     ([Pp][+-]?{D}+)
+std::size_t
+match_exp(const char* p, char e)
+{
+  if ((*p | 0x20) != e)
+    return 0;
+  std::size_t n = 1;
+  if (p[n] == '+' || p[n] == '-')
+    ++n;
+  auto d = run(p + n, kDigit);
+  return d ? n + d : 0;
+}
+
+} // namespace
+
+//==============================================================================
+// 分析器
+//==============================================================================
+
+namespace {
+
+/// 多线程分析时一块输入的结果
+struct Chunk
+{
+  struct Line
+  {
+    std::uint32_t mRow; // 在此之前本块已记录的行首数
+    Marker mMarker;
+  };
+
+  const char *mBegin, *mEnd;
+  std::vector<Token> mTokens;
+  std::vector<Offset> mLines;  // 行首
+  std::vector<Line> mMarkers;  // 行标记
+  bool mStartOfLine{ true }, mLeadingSpace{ false }; // 块结束时的状态
+};
+
+class Scanner
+{
+public:
+  /// [begin, end) 是 base 开始的整个输入中的一段，chunk 为空时直接调用 come()
+  Scanner(const char* base,
+          const char* begin,
+          const char* end,
+          Chunk* chunk = nullptr)
+    : mBase(base)
+    , mEnd(end)
+    , mP(begin)
+    , mChunk(chunk)
+  {
+  }
+
+  void operator()();
+
+  /// 在输入末尾产生 YYEOF
+  void finish() { emit(YYEOF, 0); }
+
+private:
+  const char *mBase, *mEnd, *mP;
+  Chunk* mChunk;
+  bool mStartOfLine{ true }, mLeadingSpace{ false };
+
+  void emit(int id, std::size_t len)
+  {
+    auto off = Offset(mP - mBase);
+    if (mChunk)
+      mChunk->mTokens.push_back(
+        { Id(id), off, std::uint32_t(len), mStartOfLine, mLeadingSpace });
+    else {
+      g.mStartOfLine = mStartOfLine;
+      g.mLeadingSpace = mLeadingSpace;
+      come(id, mP, len, off);
+    }
+    mStartOfLine = mLeadingSpace = false;
+    mP += len;
+  }
+
+  void add_line(const char* p)
+  {
+    if (mChunk)
+      mChunk->mLines.push_back(Offset(p - mBase));
+    else
+      gSource.add_line(Offset(p - mBase));
+  }
+
+  void blank();
+
+  void marker();
+
+  std::size_t ident();
+
+  std::size_t number();
+
+  std::size_t literal(const char* q);
+
+  void punct();
+};
+
+void
+Scanner::operator()()
+{
+  while (mP < mEnd) {
+    auto c = *mP;
+
+    if (kIs(c, kBlank))
+      blank();
+
+    else if (kIs(c, kDigit) || (c == '.' && kIs(mP[1], kDigit)))
+      emit(CONSTANT, number());
+
+    else if (kIs(c, kIdent)) {
+      // L'x' 和 L"x" 比标识符 L 更长
+      if (c == 'L' && (mP[1] == '\'' || mP[1] == '"')) {
+        if (auto n = literal(mP + 1)) {
+          emit(mP[1] == '"' ? STRING_LITERAL : CONSTANT, n + 1);
+          continue;
+        }
+      }
+      auto n = ident();
+      emit(keyword(mP, n), n);
+    }
+
+    else if (c == '\'' || c == '"') {
+      if (auto n = literal(mP))
+        emit(c == '"' ? STRING_LITERAL : CONSTANT, n);
+      else
+        emit(YYUNDEF, 1);
+    }
+
+    else if (c == '#' && (mP == mBase || mP[-1] == '\n'))
+      marker();
+
+    else
+      punct();
+  }
+
+  if (mChunk) {
+    mChunk->mStartOfLine = mStartOfLine;
+    mChunk->mLeadingSpace = mLeadingSpace;
+  }
+}
+
+void
+Scanner::blank()
+{
+  auto b = kKernels.mBlankEnd(mP, mEnd);
+  if (b.mLines) {
+    for (auto p = mP; p <= b.mLastNl; ++p) {
+      if (*p == '\n')
+        add_line(p + 1);
+    }
+    mStartOfLine = true;
+    mLeadingSpace = b.mEnd - 1 != b.mLastNl;
+  } else
+    mLeadingSpace = true;
+  mP = b.mEnd;
+}
+
+void
+Scanner::marker()
+{
+  auto eol = static_cast<const char*>(std::memchr(mP, '\n', mEnd - mP));
+  if (mChunk)
+    mChunk->mMarkers.push_back(
+      { std::uint32_t(mChunk->mLines.size()), parse_marker(mP) });
+  else
+    read_path(mP);
+  mP = eol ? eol : mEnd;
+}
+
+std::size_t
+Scanner::ident()
+{
+  return kKernels.mIdentEnd(mP + 1, mEnd) - mP;
+}
+
+std::size_t
+Scanner::number()
+{
+  auto p = mP;
+  std::size_t d = kKernels.mDigitEnd(p, mEnd) - p, best = 0;
+  auto take = [&best](std::size_t n) {
+    if (n > best)
+      best = n;
+  };
+
+  // 整数
+  if (p[0] == '0') {
+    auto o = 1 + run(p + 1, kOct);
+    take(o + match_is(p + o));
+  } else if (d != 0)
+    take(d + match_is(p + d));
+
+  // 十进制浮点数
+  if (d != 0) {
+    if (auto e = match_exp(p + d, 'e'))
+      take(d + e + match_fs(p + d + e));
+  }
+  if (p[d] == '.') {
+    auto n = d + 1 + (kKernels.mDigitEnd(p + d + 1, mEnd) - (p + d + 1));
+    if (n > d + 1 || d != 0) {
+      n += match_exp(p + n, 'e');
+      take(n + match_fs(p + n));
+    }
+  }
+
+  // 十六进制整数和浮点数
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    auto h = run(p + 2, kHex), n = 2 + h;
+    if (h != 0) {
+      take(n + match_is(p + n));
+      if (auto e = match_exp(p + n, 'p'))
+        take(n + e + match_fs(p + n + e));
+    }
+    if (p[n] == '.') {
+      auto h1 = run(p + n + 1, kHex);
+      if (h != 0 || h1 != 0) {
+        auto m = n + 1 + h1;
+        m += match_exp(p + m, 'p');
+        take(m + match_fs(p + m));
+      }
+    }
+  }
+
+  return best;
+}
+
+std::size_t
+Scanner::literal(const char* q)
+{
+  auto quote = *q;
+  auto p = q + 1;
+  while (true) {
+    p = kKernels.mQuoteEnd(p, mEnd, quote);
+    if (p == mEnd || *p == '\n')
+      return 0;
+
+    if (*p == quote) {
+      // 字符常量不能为空
+      if (quote == '\'' && p == q + 1)
+        return 0;
+      return p + 1 - q;
+    }
+
+    // \\. 中的 . 不匹配换行
+    if (p + 1 == mEnd || p[1] == '\n')
+      return 0;
+    p += 2;
+  }
+}
+
+void
+Scanner::punct()
+{
+  auto c0 = mP[0], c1 = mP[1], c2 = mP[2];
+
+  switch (c0) {
+    case '.':
+      if (c1 == '.' && c2 == '.')
+        return emit(ELLIPSIS, 3);
+      return emit('.', 1);
+
+    case '>':
+      if (c1 == '>')
+        return c2 == '=' ? emit(RIGHT_ASSIGN, 3) : emit(RIGHT_OP, 2);
+      if (c1 == '=')
+        return emit(GE_OP, 2);
+      return emit('>', 1);
+
+    case '<':
+      if (c1 == '<')
+        return c2 == '=' ? emit(LEFT_ASSIGN, 3) : emit(LEFT_OP, 2);
+      if (c1 == '=')
+        return emit(LE_OP, 2);
+      if (c1 == '%')
+        return emit(L_BRACE, 2);
+      if (c1 == ':')
+        return emit(L_SQUARE, 2);
+      return emit('<', 1);
+
+    case '+':
+      if (c1 == '=')
+        return emit(ADD_ASSIGN, 2);
+      if (c1 == '+')
+        return emit(INC_OP, 2);
+      return emit(PLUS, 1);
+
+    case '-':
+      if (c1 == '=')
+        return emit(SUB_ASSIGN, 2);
+      if (c1 == '-')
+        return emit(DEC_OP, 2);
+      if (c1 == '>')
+        return emit(PTR_OP, 2);
+      return emit(MINUS, 1);
+
+    case '*':
+      return c1 == '=' ? emit(MUL_ASSIGN, 2) : emit('*', 1);
+
+    case '/':
+      return c1 == '=' ? emit(DIV_ASSIGN, 2) : emit('/', 1);
+
+    case '%':
+      if (c1 == '=')
+        return emit(MOD_ASSIGN, 2);
+      if (c1 == '>')
+        return emit(R_BRACE, 2);
+      return emit('%', 1);
+
+    case '&':
+      if (c1 == '=')
+        return emit(AND_ASSIGN, 2);
+      if (c1 == '&')
+        return emit(AND_OP, 2);
+      return emit('&', 1);
+
+    case '^':
+      return c1 == '=' ? emit(XOR_ASSIGN, 2) : emit('^', 1);
+
+    case '|':
+      if (c1 == '=')
+        return emit(OR_ASSIGN, 2);
+      if (c1 == '|')
+        return emit(OR_OP, 2);
+      return emit('|', 1);
+
+    case '=':
+      return c1 == '=' ? emit(EQ_OP, 2) : emit(EQUAL, 1);
+
+    case '!':
+      return c1 == '=' ? emit(NE_OP, 2) : emit('!', 1);
+
+    case ':':
+      return c1 == '>' ? emit(R_SQUARE, 2) : emit(':', 1);
+
+    case ';':
+      return emit(SEMI, 1);
+    case '{':
+      return emit(L_BRACE, 1);
+    case '}':
+      return emit(R_BRACE, 1);
+    case ',':
+      return emit(COMMA, 1);
+    case '(':
+      return emit(L_PAREN, 1);
+    case ')':
+      return emit(R_PAREN, 1);
+    case '[':
+      return emit(L_SQUARE, 1);
+    case ']':
+      return emit(R_SQUARE, 1);
+    case '~':
+      return emit('~', 1);
+    case '?':
+      return emit('?', 1);
+
+    default:
+      return emit(YYUNDEF, 1);
+  }
+}
+
+} // namespace
+
+void
+scan(const char* begin, const char* end)
+{
+  Scanner scanner(begin, begin, end);
+  scanner();
+  scanner.finish();
+}
+
+void
+scan_parallel(const char* begin, const char* end, unsigned jobs)
+{
+  // 块数多于线程数，先做完的线程可以接着领下一块
+  std::size_t count = std::size_t(jobs) * 4;
+  std::size_t target = (end - begin) / count + 1;
+
+  std::vector<Chunk> chunks;
+  for (auto p = begin; p < end;) {
+    auto q = p + std::min<std::size_t>(target, end - p);
+    auto nl = static_cast<const char*>(std::memchr(q, '\n', end - q));
+    q = nl ? nl + 1 : end;
+    auto& chunk = chunks.emplace_back();
+    chunk.mBegin = p;
+    chunk.mEnd = q;
+    p = q;
+  }
+
+  std::atomic<std::size_t> next{ 0 };
+  auto work = [&]() {
+    for (std::size_t i; (i = next++) < chunks.size();) {
+      auto& chunk = chunks[i];
+      chunk.mTokens.reserve((chunk.mEnd - chunk.mBegin) / 4);
+      Scanner(begin, chunk.mBegin, chunk.mEnd, &chunk)();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; ++i)
+    threads.emplace_back(work);
+  work();
+  for (auto&& t : threads)
+    t.join();
+
+  // 先按顺序登记所有行首和行标记，输出时 gSource 才能解码任意位置
+  for (auto&& chunk : chunks) {
+    std::size_t row = 0;
+    for (auto&& m : chunk.mMarkers) {
+      for (; row < m.mRow; ++row)
+        gSource.add_line(chunk.mLines[row]);
+      gSource.add_marker(gSource.intern(m.mMarker.mPath), m.mMarker.mLine);
+    }
+    for (; row < chunk.mLines.size(); ++row)
+      gSource.add_line(chunk.mLines[row]);
+  }
+
+  for (auto&& chunk : chunks) {
+    for (auto&& t : chunk.mTokens) {
+      g.mStartOfLine = t.mStartOfLine;
+      g.mLeadingSpace = t.mLeadingSpace;
+      come(t.mId, begin + t.mOffset, t.mLength, t.mOffset);
+    }
+    // 输出完就释放，峰值内存不必同时容纳所有块的词法单元
+    std::vector<Token>().swap(chunk.mTokens);
+  }
+
+  g.mStartOfLine = chunks.empty() || chunks.back().mStartOfLine;
+  g.mLeadingSpace = !chunks.empty() && chunks.back().mLeadingSpace;
+  come(YYEOF, end, 0, Offset(end - begin));
+}
+
+std::vector<Token>
+tokenize(const char* begin, const char* end, std::size_t capacity)
+{
+  assert(capacity >= std::size_t(end - begin) + kReadAhead);
+
+  Chunk chunk;
+  chunk.mBegin = begin;
+  chunk.mEnd = end;
+
+  Scanner scanner(begin, begin, end, &chunk);
+  scanner();
+  scanner.finish();
+  return std::move(chunk.mTokens);
+}
+
+Range
+relex(std::vector<Token>& tokens,
+      const char* begin,
+      const char* end,
+      std::size_t capacity,
+      const Edit& edit)
+{
+  assert(capacity >= std::size_t(end - begin) + kReadAhead);
+
+  auto delta = std::int64_t(edit.mInserted) - std::int64_t(edit.mRemoved);
+  Offset size = end - begin, editEnd = edit.mOffset + edit.mInserted;
+
+  // 修改必须落在旧输入内，并且与新旧输入的长度吻合，否则下面的 memchr 会越界。
+  // 旧数组末尾的 YYEOF 的偏移就是旧输入的长度
+  assert(!tokens.empty() && tokens.back().mId == YYEOF);
+  [[maybe_unused]] Offset oldSize = tokens.back().mOffset;
+  assert(edit.mOffset <= oldSize && edit.mRemoved <= oldSize - edit.mOffset);
+  assert(std::int64_t(oldSize) + delta == std::int64_t(size));
+
+  auto by_offset = [](const Token& t, Offset off) { return t.mOffset < off; };
+
+  // 修改位置之前的文本没有变，从它所在行的行首开始即可
+  Offset restart = edit.mOffset;
+  while (restart > 0 && begin[restart - 1] != '\n')
+    --restart;
+  std::size_t first =
+    std::lower_bound(tokens.begin(), tokens.end(), restart, by_offset) -
+    tokens.begin();
+
+  // 最多分析到修改之后的第一个换行：此后的行首在新旧输入中都是行首，状态相同
+  auto nl = static_cast<const char*>(
+    std::memchr(begin + editEnd, '\n', size - editEnd));
+  auto stop = nl ? nl + 1 : end;
+
+  Chunk chunk;
+  chunk.mBegin = begin + restart;
+  chunk.mEnd = stop;
+  Scanner scanner(begin, chunk.mBegin, chunk.mEnd, &chunk);
+  scanner();
+  if (stop == end)
+    scanner.finish();
+  auto& fresh = chunk.mTokens;
+
+  // 找出第一个与旧词法单元重合的新词法单元，旧数组从它开始保留
+  auto keep = tokens.size();
+  auto cut = fresh.size();
+  auto old_index = [&](Offset off) {
+    return std::size_t(std::lower_bound(tokens.begin() + first,
+                                        tokens.end(),
+                                        Offset(off - delta),
+                                        by_offset) -
+                       tokens.begin());
+  };
+  for (std::size_t i = 0; i < fresh.size(); ++i) {
+    if (fresh[i].mOffset < editEnd)
+      continue;
+    auto j = old_index(fresh[i].mOffset);
+    if (j == tokens.size())
+      break;
+    auto shifted = tokens[j];
+    shifted.mOffset += delta;
+    if (shifted == fresh[i]) {
+      keep = j;
+      cut = i;
+      break;
+    }
+  }
+  if (cut == fresh.size() && stop != end)
+    keep = old_index(stop - begin);
+
+  // 拼接：旧数组的前缀 + 新分析的部分 + 平移后的旧数组后缀
+  for (auto i = keep; i < tokens.size(); ++i)
+    tokens[i].mOffset += delta;
+  tokens.erase(tokens.begin() + first, tokens.begin() + keep);
+  tokens.insert(tokens.begin() + first, fresh.begin(), fresh.begin() + cut);
+
+  return { std::size_t(first), first + cut };
+}
+
+} // namespace lex
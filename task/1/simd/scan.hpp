@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lex.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace lex {
+
+/// 向量指令越过输入结尾读取的最大字节数
+constexpr std::size_t kReadAhead = 32;
+
+/**
+ * @brief 手写的词法分析器，规则与 flex/lex.l 一一对应，产生完全相同的词法单元
+ * 序列。空白、标识符、数字和字符串字面量的内部用 SSE2/AVX2 一次检查 16/32 个
+ * 字节，每识别出一个词法单元就调用一次 come()。
+ *
+ * [begin, end) 之后必须还有至少 kReadAhead 个可读的字节，io::map_file 会补齐。
+ */
+void
+scan(const char* begin, const char* end);
+
+/**
+ * @brief 多线程版本的 scan()，结果完全相同。
+ *
+ * 没有词法单元能跨越换行，所以输入在换行之后切成若干块，每块开头的状态都是
+ * 行首、无前导空格。各块在 jobs 个线程上分别分析，词法单元和行首、行标记都先
+ * 存在块内，全部完成后再按顺序登记到 gSource 并依次调用 come()。
+ */
+void
+scan_parallel(const char* begin, const char* end, unsigned jobs);
+
+/// 存在数组中的词法单元
+struct Token
+{
+  Id mId;
+  Offset mOffset; // 在输入中的偏移
+  std::uint32_t mLength;
+  bool mStartOfLine, mLeadingSpace;
+
+  bool operator==(const Token& other) const
+  {
+    return mId == other.mId && mOffset == other.mOffset &&
+           mLength == other.mLength && mStartOfLine == other.mStartOfLine &&
+           mLeadingSpace == other.mLeadingSpace;
+  }
+};
+
+/**
+ * @brief 分析 [begin, end)，返回以 YYEOF 结尾的词法单元数组，不调用 come()。
+ *
+ * 与 scan() 一样会越过 end 读取，capacity 是从 begin 起可读的字节数，至少要有
+ * end - begin + kReadAhead；不够时请先复制到补齐的缓冲区中。
+ */
+std::vector<Token>
+tokenize(const char* begin, const char* end, std::size_t capacity);
+
+/// 对输入的一次修改，偏移和长度都以修改前的输入为准
+struct Edit
+{
+  Offset mOffset;          // 修改的位置
+  std::uint32_t mRemoved;  // 删除的字节数
+  std::uint32_t mInserted; // 插入的字节数
+};
+
+/// tokens 中重新分析过的区间 [mBegin, mEnd)
+struct Range
+{
+  std::size_t mBegin, mEnd;
+};
+
+/**
+ * @brief 增量分析：tokens 是修改前输入的 tokenize() 结果，[begin, end) 是修改后
+ * 的输入，把 tokens 原地更新成修改后输入的 tokenize() 结果。
+ *
+ * 从修改位置所在行的行首开始重新分析：行首的状态是固定的，之前的词法单元不受
+ * 影响。一旦新的词法单元与旧数组中平移后的某个词法单元完全相同，后面的结果也
+ * 必然相同，分析就此停止，旧数组的剩余部分只平移偏移。
+ *
+ * capacity 的要求与 tokenize() 相同。edit 必须落在修改前的输入内，且与修改
+ * 前后的长度吻合，否则断言失败。
+ */
+Range
+relex(std::vector<Token>& tokens,
+      const char* begin,
+      const char* end,
+      std::size_t capacity,
+      const Edit& edit);
+
+} // namespace lex
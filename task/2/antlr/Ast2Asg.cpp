@@ -1,37 +1,10 @@
 #include "Ast2Asg.hpp"
-#include <unordered_map>
+#include "literal.hpp"
 
 #define self (*this)
 
 namespace asg {
 
-struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl*>
-{
-  Ast2Asg& m;
-  Symtbl* mPrev;
-
-  Symtbl(Ast2Asg& m)
-    : m(m)
-    , mPrev(m.mSymtbl)
-  {
-    m.mSymtbl = this;
-  }
-
-  ~Symtbl() { m.mSymtbl = mPrev; }
-
-  Decl* resolve(const std::string& name);
-};
-
-Decl*
-Ast2Asg::Symtbl::resolve(const std::string& name)
-{
-  auto iter = find(name);
-  if (iter != end())
-    return iter->second;
-  ASSERT(mPrev != nullptr); // 标识符未定义
-  return mPrev->resolve(name);
-}
-
 struct Ast2Asg::CurrentLoop
 {
   Ast2Asg& m;
@@ -54,7 +27,7 @@ Ast2Asg::operator()(ast::TranslationUnitContext* ctx)
   if (ctx == nullptr)
     return ret;
 
-  Symtbl localDecls(self);
+  Symtbl::Scope scope(mSymtbl);
 
   for (auto&& i : ctx->externalDeclaration()) {
     if (auto p = i->declaration()) {
@@ -69,7 +42,7 @@ Ast2Asg::operator()(ast::TranslationUnitContext* ctx)
       ret.push_back(funcDecl);
 
       // 添加到声明表
-      localDecls[funcDecl->name] = funcDecl;
+      declare(funcDecl);
     }
 
     else if (auto p = i->Semi())
@@ -180,7 +153,7 @@ Ast2Asg::operator()(ast::DeclarationSpecifiers2Context* ctx)
   return ret;
 }
 
-std::pair<TypeExpr*, std::string>
+std::pair<TypeExpr*, atom::Atom>
 Ast2Asg::operator()(ast::DeclaratorContext* ctx, TypeExpr* sub)
 {
   return self(ctx->directDeclarator(), sub);
@@ -189,14 +162,14 @@ Ast2Asg::operator()(ast::DeclaratorContext* ctx, TypeExpr* sub)
 static int
 eval_arrlen(Expr* expr)
 {
-  if (auto p = expr->dcst<IntegerLiteral>())
+  if (auto p = dyn_cast<IntegerLiteral>(expr))
     return p->val;
 
-  if (auto p = expr->dcst<DeclRefExpr>()) {
+  if (auto p = dyn_cast<DeclRefExpr>(expr)) {
     if (p->decl == nullptr)
       ABORT();
 
-    auto var = p->decl->dcst<VarDecl>();
+    auto var = dyn_cast<VarDecl>(p->decl);
     if (!var || var->type.qual != Type::Qual::kConst)
       ABORT(); // 数组长度必须是编译期常量
 
@@ -212,7 +185,7 @@ eval_arrlen(Expr* expr)
     }
   }
 
-  if (auto p = expr->dcst<UnaryExpr>()) {
+  if (auto p = dyn_cast<UnaryExpr>(expr)) {
     auto sub = eval_arrlen(p->sub);
 
     switch (p->op) {
@@ -230,7 +203,7 @@ eval_arrlen(Expr* expr)
     }
   }
 
-  if (auto p = expr->dcst<BinaryExpr>()) {
+  if (auto p = dyn_cast<BinaryExpr>(expr)) {
     auto lft = eval_arrlen(p->lft);
     auto rht = eval_arrlen(p->rht);
 
@@ -279,7 +252,7 @@ eval_arrlen(Expr* expr)
     }
   }
 
-  if (auto p = expr->dcst<InitListExpr>()) {
+  if (auto p = dyn_cast<InitListExpr>(expr)) {
     if (p->list.empty())
       return 0;
     return eval_arrlen(p->list[0]);
@@ -288,37 +261,36 @@ eval_arrlen(Expr* expr)
   ABORT();
 }
 
-std::pair<TypeExpr*, std::string>
+std::pair<TypeExpr*, atom::Atom>
 Ast2Asg::operator()(ast::DirectDeclaratorContext* ctx, TypeExpr* sub)
 {
   if (auto p = ctx->Identifier())
-    return { sub, p->getText() };
+    return { sub, atom::intern(p->getText()) };
 
   if (auto p = ctx->declarator())
     return self(p, sub);
 
   if (ctx->LeftBracket()) {
-    auto& arrayType = make<ArrayType>();
-    arrayType.sub = sub;
-
+    auto len = ArrayType::kUnLen;
     if (auto p = ctx->assignmentExpression())
-      arrayType.len = eval_arrlen(self(p));
-    else
-      arrayType.len = ArrayType::kUnLen;
+      len = eval_arrlen(self(p));
 
-    return self(ctx->directDeclarator(), &arrayType);
+    return self(ctx->directDeclarator(), mTypes.array(sub, len));
   }
 
   if (ctx->LeftParen()) {
-    auto& funcType = make<FunctionType>();
-    funcType.sub = sub;
-
+    std::vector<Decl*> params;
+    std::vector<Type> paramTypes;
     if (auto p = ctx->parameterTypeList()) {
-      for (auto&& i : p->parameterList()->parameterDeclaration())
-        funcType.params.push_back(self(i));
+      for (auto&& i : p->parameterList()->parameterDeclaration()) {
+        params.push_back(self(i));
+        paramTypes.push_back(params.back()->type);
+      }
     }
+    mParams = std::move(params);
 
-    return self(ctx->directDeclarator(), &funcType);
+    return self(ctx->directDeclarator(),
+                mTypes.function(sub, std::move(paramTypes)));
   }
 
   ABORT();
@@ -337,27 +309,21 @@ Ast2Asg::operator()(ast::DirectAbstractDeclaratorContext* ctx, TypeExpr* sub)
     return self(p, sub);
 
   if (ctx->LeftBracket()) {
-    auto& arrayType = make<ArrayType>();
-    arrayType.sub = sub;
-
+    auto len = ArrayType::kUnLen;
     if (auto p = ctx->assignmentExpression())
-      arrayType.len = eval_arrlen(self(p));
-    else
-      arrayType.len = ArrayType::kUnLen;
+      len = eval_arrlen(self(p));
 
-    sub = &arrayType;
+    sub = mTypes.array(sub, len);
   }
 
   else if (ctx->LeftParen()) {
-    auto& funcType = make<FunctionType>();
-    funcType.sub = sub;
-
+    std::vector<Type> paramTypes;
     if (auto p = ctx->parameterTypeList()) {
       for (auto&& i : p->parameterList()->parameterDeclaration())
-        funcType.params.push_back(self(i));
+        paramTypes.push_back(self(i)->type);
     }
 
-    sub = &funcType;
+    sub = mTypes.function(sub, std::move(paramTypes));
   }
 
   else
@@ -672,9 +638,9 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
   }
 
   if (auto p = ctx->Identifier()) {
-    auto name = p->getText();
     auto& ret = make<DeclRefExpr>();
-    ret.decl = mSymtbl->resolve(name);
+    ret.decl = mSymtbl.resolve(atom::intern(p->getText()));
+    ASSERT(ret.decl); // 标识符未定义
     return &ret;
   }
 
@@ -683,18 +649,9 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
 
     auto& ret = make<IntegerLiteral>();
 
-    ASSERT(!text.empty());
-    if (text[0] != '0')
-      ret.val = std::stoll(text);
-
-    else if (text.size() == 1)
-      ret.val = 0;
-
-    else if (text[1] == 'x' || text[1] == 'X')
-      ret.val = std::stoll(text.substr(2), nullptr, 16);
-
-    else
-      ret.val = std::stoll(text.substr(1), nullptr, 8);
+    literal::Integer value;
+    ASSERT(literal::decode(text.data(), text.size(), value));
+    ret.val = value.mValue;
 
     return &ret;
   }
@@ -702,6 +659,7 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
   auto stringLiteral = ctx->StringLiteral();
   if (stringLiteral.size() != 0) {
     auto& ret = make<StringLiteral>();
+    std::string val;
 
     for (auto&& j : stringLiteral) {
       auto s = j->getText();
@@ -718,47 +676,47 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
               break;
 
             case '\'':
-              ret.val.push_back('\'');
+              val.push_back('\'');
               break;
 
             case '"':
-              ret.val.push_back('"');
+              val.push_back('"');
               break;
 
             case '?':
-              ret.val.push_back('\?');
+              val.push_back('\?');
               break;
 
             case '\\':
-              ret.val.push_back('\\');
+              val.push_back('\\');
               break;
 
             case 'a':
-              ret.val.push_back('\a');
+              val.push_back('\a');
               break;
 
             case 'b':
-              ret.val.push_back('\b');
+              val.push_back('\b');
               break;
 
             case 'f':
-              ret.val.push_back('\f');
+              val.push_back('\f');
               break;
 
             case 'n':
-              ret.val.push_back('\n');
+              val.push_back('\n');
               break;
 
             case 'r':
-              ret.val.push_back('\r');
+              val.push_back('\r');
               break;
 
             case 't':
-              ret.val.push_back('\t');
+              val.push_back('\t');
               break;
 
             case 'v':
-              ret.val.push_back('\v');
+              val.push_back('\v');
               break;
 
             default:
@@ -767,13 +725,14 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
         }
 
         else {
-          ret.val.push_back(s[i]);
+          val.push_back(s[i]);
         }
 
         ++i;
       }
     }
 
+    ret.val = atom::intern(val);
     return &ret;
   }
 
@@ -827,7 +786,7 @@ Ast2Asg::operator()(ast::CompoundStatementContext* ctx)
   auto& ret = make<CompoundStmt>();
 
   if (auto p = ctx->blockItemList()) {
-    Symtbl localDecls(self);
+    Symtbl::Scope scope(mSymtbl);
 
     for (auto&& i : p->blockItem()) {
       if (auto q = i->declaration()) {
@@ -856,7 +815,7 @@ Ast2Asg::operator()(ast::ExpressionStatementContext* ctx)
     return &ret;
   }
 
-  return &make<Stmt>();
+  return &make<NullStmt>();
 }
 
 Stmt*
@@ -964,24 +923,23 @@ Ast2Asg::operator()(ast::FunctionDefinitionContext* ctx)
   ret.type.spec = sq.first, ret.type.qual = sq.second;
 
   auto [texp, name] = self(ctx->directDeclarator(), nullptr);
-  auto& funcType = make<FunctionType>();
-  funcType.sub = texp;
-  ret.type.texp = &funcType;
-  ret.name = std::move(name);
+  ret.name = name;
 
-  Symtbl localDecls(self);
+  Symtbl::Scope scope(mSymtbl);
+  std::vector<Type> paramTypes;
   if (auto p = ctx->parameterTypeList()) {
     for (auto&& i : p->parameterList()->parameterDeclaration()) {
       auto varDecl = self(i);
       ret.params.push_back(varDecl);
-      funcType.params.push_back(varDecl);
+      paramTypes.push_back(varDecl->type);
 
-      localDecls[varDecl->name] = varDecl; // !
+      declare(varDecl);
     }
   }
+  ret.type.texp = mTypes.function(texp, std::move(paramTypes));
 
   // 函数定义在签名之后就加入符号表，以允许递归调用
-  (*mSymtbl)[ret.name] = &ret;
+  declare(&ret);
 
   ret.body = self(ctx->compoundStatement());
 
@@ -994,13 +952,13 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
   auto [texp, name] = self(ctx->declarator(), nullptr);
   Decl* ret;
 
-  if (auto funcType = texp->dcst<FunctionType>()) {
+  if (auto funcType = dyn_cast<FunctionType>(texp)) {
     auto& fdecl = make<FunctionDecl>();
     fdecl.type.spec = sq.first;
     fdecl.type.qual = sq.second;
     fdecl.type.texp = funcType;
-    fdecl.name = std::move(name);
-    fdecl.params = funcType->params;
+    fdecl.name = name;
+    fdecl.params = std::exchange(mParams, {});
 
     if (ctx->initializer())
       ABORT();
@@ -1014,7 +972,7 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
     vdecl.type.spec = sq.first;
     vdecl.type.qual = sq.second;
     vdecl.type.texp = texp;
-    vdecl.name = std::move(name);
+    vdecl.name = name;
 
     if (auto p = ctx->initializer())
       vdecl.init = self(p);
@@ -1025,7 +983,7 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
   }
 
   // 这个实现允许符号重复定义，新定义会取代旧定义
-  (*mSymtbl)[ret->name] = ret;
+  declare(ret);
   return ret;
 }
 
@@ -1041,7 +999,7 @@ Ast2Asg::operator()(ast::ParameterDeclarationContext* ctx)
     auto [texp, name] = self(ctx->declarator(), nullptr);
     ret.type.texp = texp;
 
-    ret.name = std::move(name);
+    ret.name = name;
     ret.init = nullptr;
   }
 
@@ -1054,7 +1012,7 @@ Ast2Asg::operator()(ast::ParameterDeclarationContext* ctx)
     else
       ret.type.texp = nullptr;
 
-    ret.name = std::string();
+    ret.name = {};
     ret.init = nullptr;
   }
 
@@ -2,6 +2,8 @@
 
 #include "SYsU_langParser.h"
 #include "asg.hpp"
+#include "symtbl.hpp"
+#include "typectx.hpp"
 
 namespace asg {
 
@@ -11,9 +13,11 @@ class Ast2Asg
 {
 public:
   Obj::Mgr& mMgr;
+  TypeCtx& mTypes;
 
-  Ast2Asg(Obj::Mgr& mgr)
+  Ast2Asg(Obj::Mgr& mgr, TypeCtx& types)
     : mMgr(mgr)
+    , mTypes(types)
   {
   }
 
@@ -22,18 +26,24 @@ public:
 private:
   using SpecQual = std::pair<Type::Spec, Type::Qual>;
 
-  struct Symtbl;
-  Symtbl* mSymtbl{ nullptr };
+  Symtbl mSymtbl;
+
+  /// 在当前作用域中登记声明
+  void declare(Decl* decl) { mSymtbl.bind(decl->name, decl); }
 
   struct CurrentLoop;
   Stmt* mCurrentLoop{ nullptr };
 
   FunctionDecl* mCurrentFunc{ nullptr };
 
+  /// 最近一个函数声明符的形参声明。函数类型是共享的，只记形参的类型，函数原型
+  /// 的形参声明从这里取
+  std::vector<Decl*> mParams;
+
   template<typename T, typename... Args>
-  T& make(Args... args)
+  T& make(Args&&... args)
   {
-    return mMgr.make<T>(args...);
+    return mMgr.make<T>(std::forward<Args>(args)...);
   }
 
   //============================================================================
@@ -44,10 +54,10 @@ private:
 
   SpecQual operator()(ast::DeclarationSpecifiers2Context* ctx);
 
-  std::pair<TypeExpr*, std::string> operator()(ast::DeclaratorContext* ctx,
-                                               TypeExpr* sub);
+  std::pair<TypeExpr*, atom::Atom> operator()(ast::DeclaratorContext* ctx,
+                                              TypeExpr* sub);
 
-  std::pair<TypeExpr*, std::string> operator()(
+  std::pair<TypeExpr*, atom::Atom> operator()(
     ast::DirectDeclaratorContext* ctx,
     TypeExpr* sub);
 
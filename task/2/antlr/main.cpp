@@ -1,54 +1,238 @@
+#include "Asg2Bin.hpp"
 #include "Asg2Json.hpp"
 #include "Ast2Asg.hpp"
 #include "SYsU_langLexer.h"
 #include "Typing.hpp"
 #include "asg.hpp"
+#include "prof.hpp"
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
-int
-main(int argc, char* argv[])
+namespace {
+
+/// 两阶段分析的统计，批量处理多个文件时累加
+struct ParseStats
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
+  int mParses{ 0 };    // 分析的次数
+  int mFallbacks{ 0 }; // 其中 SLL 失败、回退到 LL 的次数
+} gParseStats;
+
+/**
+ * @brief 先用 SLL 预测模式分析，出错时立即放弃，换成完整的 LL 模式从头再来。
+ *
+ * SLL 不考虑调用栈的上下文，比 LL 快得多；对合法输入，SLL 成功时的结果与 LL
+ * 完全相同。SLL 失败可能是真正的语法错误，也可能只是 SLL 能力不够，两种情况
+ * 都交给 LL 重新分析，错误报告因此与只用 LL 时一致。
+ */
+SYsU_langParser::CompilationUnitContext*
+parse(antlr4::CommonTokenStream& tokens, SYsU_langParser& parser)
+{
+  using antlr4::atn::PredictionMode;
+
+  ++gParseStats.mParses;
+  auto interp = parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+  interp->setPredictionMode(PredictionMode::SLL);
+  parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+  parser.removeErrorListeners();
+
+  try {
+    return parser.compilationUnit();
+  } catch (antlr4::ParseCancellationException&) {
   }
 
-  std::ifstream inFile(argv[1]);
+  ++gParseStats.mFallbacks;
+  tokens.seek(0);
+  parser.reset();
+  parser.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+  parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+  interp->setPredictionMode(PredictionMode::LL);
+  return parser.compilationUnit();
+}
+
+/// 分析 inPath，结果写入 outPath，bin 为真时写成二进制语义图。返回值与 main
+/// 的相同
+int
+run(const char* inPath, const char* outPath, bool llOnly, bool bin)
+{
+  std::ifstream inFile(inPath);
   if (!inFile) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inPath << '\n';
     return -2;
   }
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
     return -3;
   }
 
-  std::cout << "程序 " << argv[0] << std::endl;
-  std::cout << "输入 " << argv[1] << std::endl;
-  std::cout << "输出 " << argv[2] << std::endl;
+  std::cout << "输入 " << inPath << std::endl;
+  std::cout << "输出 " << outPath << std::endl;
 
+  prof::Timer lexTimer("lex");
   antlr4::ANTLRInputStream input(inFile);
   SYsU_langLexer lexer(&input);
 
+  // 先取出全部词法单元，统计时词法分析与语法分析分开
   antlr4::CommonTokenStream tokens(&lexer);
+  tokens.fill();
+  lexTimer.stop();
+  prof::count("lex", "tokens", tokens.size());
+
   SYsU_langParser parser(&tokens);
 
-  auto ast = parser.compilationUnit();
+  auto ast = prof::timed("parse", [&] {
+    return llOnly ? parser.compilationUnit() : parse(tokens, parser);
+  });
   asg::Obj::Mgr mgr;
+  asg::TypeCtx types(mgr);
+
+  asg::Ast2Asg ast2asg(mgr, types);
+  auto asg =
+    prof::timed("Ast2Asg", [&] { return ast2asg(ast->translationUnit()); });
+  auto nodes = mgr.size();
+  prof::count("Ast2Asg", "nodes", nodes);
+
+  asg::Typing inferType(mgr, types);
+  prof::timed("Typing", [&] { inferType(asg); });
+  prof::count("Typing", "nodes", mgr.size() - nodes);
+
+  if (bin) {
+    prof::timed("Asg2Bin", [&] {
+      asg::Asg2Bin asg2bin(outFile);
+      asg2bin(asg);
+      outFile.flush();
+    });
+    return 0;
+  }
+
+  // 边遍历边写出，输出阶段合并在 Asg2Json 中
+  prof::timed("Asg2Json", [&] {
+    llvm::json::OStream jos(outFile);
+    asg::Asg2Json asg2json(jos);
+    asg2json(asg);
+    outFile << '\n';
+    outFile.flush();
+  });
+  return 0;
+}
 
-  asg::Ast2Asg ast2asg(mgr);
-  auto asg = ast2asg(ast->translationUnit());
+/// 读入列表文件，每行是以空白分隔的输入路径和输出路径，空行忽略
+std::vector<std::pair<std::string, std::string>>
+read_list(const char* path)
+{
+  std::vector<std::pair<std::string, std::string>> ret;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string in, out;
+    if (fields >> in) {
+      fields >> out;
+      ret.emplace_back(std::move(in), std::move(out));
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief 对列表中的每个输入做一遍词法和语法分析，结果丢弃。
+ *
+ * ANTLR 生成的分析器把 ATN 模拟器的 DFA 缓存放在静态数据中，同一进程内的所有
+ * 实例共用，预热之后分析新文件时大多只需查表。预热不计入 gParseStats。
+ */
+void
+warmup(const char* listPath, bool llOnly)
+{
+  auto begin = std::chrono::steady_clock::now();
+  prof::Timer timer("warmup");
+  auto list = read_list(listPath);
+  auto stats = gParseStats;
+  for (auto&& [in, out] : list) {
+    std::ifstream inFile(in);
+    if (!inFile)
+      continue;
+    antlr4::ANTLRInputStream input(inFile);
+    SYsU_langLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    SYsU_langParser parser(&tokens);
+    if (llOnly)
+      parser.compilationUnit();
+    else
+      parse(tokens, parser);
+  }
+  gParseStats = stats;
+
+  std::chrono::duration<double> time =
+    std::chrono::steady_clock::now() - begin;
+  std::cout << "预热 " << list.size() << " 个文件，用时 " << time.count()
+            << " 秒" << std::endl;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  // --ll 跳过 SLL，只用完整的 LL 模式，用于对比。批量模式 --batch <列表> 在一
+  // 个进程中处理多个文件，ANTLR 的 DFA 缓存在文件之间保留。
+  // --time-report[=<file>] 在结束时打印各阶段的耗时和内存，可另存为 JSON。
+  // --format=bin 输出二进制语义图，供实验三直接读入，默认仍输出 JSON
+  bool llOnly = false;
+  bool bin = false;
+  const char* warmupList = nullptr;
+  const char* batchList = nullptr;
+  int i = 1;
+  for (; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--ll") == 0)
+      llOnly = true;
+    else if (std::strcmp(argv[i], "--format=json") == 0)
+      bin = false;
+    else if (std::strcmp(argv[i], "--format=bin") == 0)
+      bin = true;
+    else if (prof::Report::global().parse_flag(argv[i]))
+      continue;
+    else if (i + 1 < argc && std::strcmp(argv[i], "--warmup") == 0)
+      warmupList = argv[++i];
+    else if (i + 1 < argc && std::strcmp(argv[i], "--batch") == 0)
+      batchList = argv[++i];
+    else
+      break;
+  }
+
+  if (batchList ? i != argc : argc - i != 2) {
+    std::cout << "Usage: " << argv[0]
+              << " [--ll] [--format=json|bin] [--warmup <list>]"
+                 " [--time-report[=<file>]] <input> <output>\n"
+              << "       " << argv[0]
+              << " [--ll] [--format=json|bin] [--warmup <list>]"
+                 " [--time-report[=<file>]] --batch <list>\n";
+    return -1;
+  }
 
-  asg::Typing inferType(mgr);
-  inferType(asg);
+  std::cout << "程序 " << argv[0] << std::endl;
+  if (warmupList)
+    warmup(warmupList, llOnly);
+
+  int ret = 0;
+  if (!batchList)
+    ret = run(argv[i], argv[i + 1], llOnly, bin);
+  else {
+    for (auto&& [in, out] : read_list(batchList)) {
+      if (auto r = run(in.c_str(), out.c_str(), llOnly, bin))
+        ret = r;
+    }
+  }
 
-  asg::Asg2Json asg2json;
-  llvm::json::Value json = asg2json(asg);
+  if (!llOnly)
+    std::cout << "SLL 分析 " << gParseStats.mParses << " 次，回退到 LL "
+              << gParseStats.mFallbacks << " 次" << std::endl;
 
-  outFile << json << '\n';
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
+  return ret;
 }
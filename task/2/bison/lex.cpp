@@ -1,5 +1,13 @@
 #include "lex.hpp"
+#include "tokcache.hpp"
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int
+yylex_flex(); // 由 Flex 生成，见 lex.l 中的 YY_DECL
 
 namespace lex {
 
@@ -12,6 +20,16 @@ come(int tokenId, const char* yytext, int yyleng, int yylineno)
   g.mText = { yytext, std::size_t(yyleng) };
   g.mLine = yylineno;
 
+  // 常量在这里解码一次，浮点常量不解码
+  literal::Integer value;
+  if (tokenId == CONSTANT)
+    literal::decode(yytext, yyleng, value);
+  g.mValue = value.mValue;
+  g.mSuffix = value.mSuffix;
+
+  // 标识符在这里驻留一次，之后 ASG 中的名字都是同一个 Atom
+  g.mAtom = tokenId == IDENTIFIER ? atom::intern(g.mText) : atom::Atom();
+
   g.mStartOfLine = false;
   g.mLeadingSpace = false;
 
@@ -35,4 +53,77 @@ spaces(const char* yytext, int yyleng)
   }
 }
 
+namespace {
+
+/// 只读映射整个文件，程序结束前不解除
+const char*
+map_file(const char* path, std::size_t& size)
+{
+  int fd = ::open(path, O_RDONLY);
+  if (fd == -1)
+    return nullptr;
+
+  struct stat st;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &st) == 0) {
+    size = st.st_size;
+    base = size == 0 ? nullptr
+                     : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+
+  if (base == MAP_FAILED)
+    return nullptr;
+  return base ? static_cast<const char*>(base) : "";
+}
+
+const char* sSource = nullptr;
+tokcache::View sTokens;
+std::size_t sNext = 0;
+std::uint32_t sFile = -1;
+
+} // namespace
+
+bool
+load_tokens(const char* cachePath, const char* sourcePath)
+{
+  std::size_t cacheSize = 0, sourceSize = 0;
+  auto cache = map_file(cachePath, cacheSize);
+  auto source = map_file(sourcePath, sourceSize);
+  if (!cache || !source ||
+      !sTokens.bind(cache, cacheSize, source, sourceSize))
+    return false;
+
+  sSource = source;
+  return true;
+}
+
 } // namespace lex
+
+int
+yylex()
+{
+  using namespace lex;
+
+  if (!sSource)
+    return yylex_flex();
+  if (sNext == sTokens.size())
+    return YYEOF;
+
+  auto i = sNext++;
+  if (sTokens.file(i) != sFile) {
+    sFile = sTokens.file(i);
+    g.mFile = sTokens.path(sFile);
+  }
+
+  g.mId = sTokens.id(i);
+  g.mText = { sSource + sTokens.offset(i), sTokens.length(i) };
+  g.mLine = sTokens.line(i);
+  g.mColumn = sTokens.column(i) + sTokens.length(i) - 1;
+  g.mStartOfLine = sTokens.flags(i) & tokcache::kStartOfLine;
+  g.mLeadingSpace = sTokens.flags(i) & tokcache::kLeadingSpace;
+  g.mValue = sTokens.value(i);
+  g.mSuffix = literal::Suffix(sTokens.flags(i) >> tokcache::kSuffixShift);
+  g.mAtom = g.mId == IDENTIFIER ? atom::intern(g.mText) : atom::Atom();
+  return g.mId;
+}
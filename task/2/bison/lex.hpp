@@ -1,5 +1,7 @@
 #pragma once
 
+#include "atom.hpp"
+#include "literal.hpp"
 #include "par.y.hh"
 #include <string>
 #include <string_view>
@@ -10,8 +12,11 @@ struct G
 {
   int mId{ YYEOF };             // 词号
   std::string_view mText;       // 对应文本
+  atom::Atom mAtom;             // 标识符驻留后的 Atom，语法动作直接使用
   std::string mFile;            // 文件路径
   int mLine{ 0 }, mColumn{ 0 }; // 行号、列号
+  std::uint64_t mValue{ 0 };    // 整数或字符常量的值，语法动作直接使用
+  literal::Suffix mSuffix{};    // 整数常量的后缀
   bool mStartOfLine{ true };    // 是否是行首
   bool mLeadingSpace{ false };  // 是否有前导空格
 };
@@ -24,4 +29,11 @@ come(int tokenId, const char* yytext, int yyleng, int yylineno);
 void
 spaces(const char* yytext, int yyleng);
 
+/**
+ * @brief 读入实验一 --emit-tokens 生成的词法单元缓存，之后 yylex 直接从缓存中
+ * 取词法单元，不再调用 flex。缓存与源文件内容不符时拒绝使用并返回 false。
+ */
+bool
+load_tokens(const char* cachePath, const char* sourcePath);
+
 } // namespace lex
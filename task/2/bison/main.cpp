@@ -1,15 +1,42 @@
+#include "Asg2Bin.hpp"
 #include "Asg2Json.hpp"
 #include "Typing.hpp"
+#include "lex.hpp"
 #include "lex.l.hh"
 #include "par.y.hh"
+#include "prof.hpp"
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
 int
 main(int argc, char* argv[])
 {
+  auto prog = argv[0];
+
+  // --tokens <cache>：直接读入实验一 --emit-tokens 生成的缓存，跳过词法分析
+  // --format=bin：输出二进制语义图，供实验三直接读入，默认仍输出 JSON
+  // --time-report[=<file>]：结束时打印各阶段的耗时和内存，可另存为 JSON
+  const char* cachePath = nullptr;
+  bool bin = false;
+  while (argc > 3) {
+    if (prof::Report::global().parse_flag(argv[1]))
+      ++argv, --argc;
+    else if (std::strcmp(argv[1], "--format=json") == 0)
+      bin = false, ++argv, --argc;
+    else if (std::strcmp(argv[1], "--format=bin") == 0)
+      bin = true, ++argv, --argc;
+    else if (argc > 4 && std::strcmp(argv[1], "--tokens") == 0) {
+      cachePath = argv[2];
+      argv += 2, argc -= 2;
+    } else
+      break;
+  }
+
   if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
+    std::cout << "Usage: " << prog
+              << " [--tokens <cache>] [--format=json|bin]"
+                 " [--time-report[=<file>]] <input> <output>\n";
     return -1;
   }
 
@@ -27,18 +54,46 @@ main(int argc, char* argv[])
     return -3;
   }
 
-  std::cout << "程序 " << argv[0] << std::endl;
+  std::cout << "程序 " << prog << std::endl;
   std::cout << "输入 " << argv[1] << std::endl;
   std::cout << "输出 " << argv[2] << std::endl;
 
-  if (auto e = yyparse())
+  if (cachePath) {
+    prof::Timer timer("load-tokens");
+    if (lex::load_tokens(cachePath, argv[1]))
+      std::cout << "词法单元缓存 " << cachePath << std::endl;
+    else
+      std::cerr << "Ignored stale or invalid token cache " << cachePath
+                << '\n';
+  }
+
+  // 语义动作在分析过程中直接构造语义图，词法分析也穿插在其中
+  if (auto e = prof::timed("parse", [] { return yyparse(); }))
     return e;
+  auto nodes = par::gMgr.size();
+  prof::count("parse", "nodes", nodes);
 
-  asg::Typing typing(par::gMgr);
-  typing(*par::gTranslationUnit);
+  asg::Typing typing(par::gMgr, par::gTypes);
+  prof::timed("Typing", [&] { typing(*par::gTranslationUnit); });
+  prof::count("Typing", "nodes", par::gMgr.size() - nodes);
 
-  asg::Asg2Json asg2json;
-  auto json = asg2json(*par::gTranslationUnit);
+  if (bin)
+    prof::timed("Asg2Bin", [&] {
+      asg::Asg2Bin asg2bin(outFile);
+      asg2bin(*par::gTranslationUnit);
+      outFile.flush();
+    });
+  else
+    prof::timed("Asg2Json", [&] {
+      llvm::json::OStream jos(outFile);
+      asg::Asg2Json asg2json(jos);
+      asg2json(*par::gTranslationUnit);
+      outFile << '\n';
+      outFile.flush();
+    });
 
   fclose(yyin);
+
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
 }
@@ -4,7 +4,9 @@
 namespace par {
 
 asg::Obj::Mgr gMgr;
+asg::TypeCtx gTypes(gMgr);
 std::unique_ptr<asg::TranslationUnit> gTranslationUnit;
+asg::Symtbl gSymtbl;
 
 } // namespace par
 
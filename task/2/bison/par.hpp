@@ -1,11 +1,20 @@
 #pragma once
 
 #include "asg.hpp"
+#include "symtbl.hpp"
+#include "typectx.hpp"
 #include <memory>
 
 namespace par {
 
 extern asg::Obj::Mgr gMgr;
+
+/// 语义动作中构造类型表达式都应经过它，节点分配在 gMgr 中
+extern asg::TypeCtx gTypes;
+
 extern std::unique_ptr<asg::TranslationUnit> gTranslationUnit;
 
+/// 语义动作中使用的符号表，与 Ast2Asg 的结构相同
+extern asg::Symtbl gSymtbl;
+
 } // namespace par
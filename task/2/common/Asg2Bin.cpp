@@ -0,0 +1,293 @@
+#include "Asg2Bin.hpp"
+#include <cstring>
+
+#define self (*this)
+
+namespace asg {
+
+void
+Asg2Bin::operator()(TranslationUnit& tu)
+{
+  // 0 号字符串是空串
+  mStrings.push_back({ 0, 0 });
+  mChars.push_back('\0');
+
+  for (auto&& i : tu)
+    mTop.push_back(ref(i));
+
+  while (!mPending.empty()) {
+    auto obj = mPending.back();
+    mPending.pop_back();
+    fill(obj);
+  }
+
+  write();
+}
+
+std::uint32_t
+Asg2Bin::str(atom::Atom atom)
+{
+  if (atom.id() >= mStrIds.size())
+    mStrIds.resize(std::max<std::size_t>(atom.id() + 1, mStrIds.size() * 2));
+  auto& ret = mStrIds[atom.id()];
+  if (ret == 0 && !atom.empty()) {
+    ASSERT(mChars.size() + atom.size() < UINT32_MAX);
+    ret = mStrings.size();
+    mStrings.push_back(
+      { std::uint32_t(mChars.size()), std::uint32_t(atom.size()) });
+    mChars.append(atom.c_str(), atom.size() + 1);
+  }
+  return ret;
+}
+
+std::uint32_t
+Asg2Bin::texp(TypeExpr* texp)
+{
+  if (texp == nullptr)
+    return 0;
+  if (auto ret = mTypeIds[texp])
+    return ret;
+
+  // 子类型先写，读入时总能按顺序构建
+  asgbin::TypeRec rec{};
+  rec.mKind = std::uint8_t(texp->tag);
+  rec.mSub = self.texp(texp->sub);
+
+  if (auto p = dyn_cast<PointerType>(texp))
+    rec.mQual = std::uint8_t(p->qual);
+  else if (auto p = dyn_cast<ArrayType>(texp))
+    rec.mA = p->len;
+  else if (auto p = dyn_cast<FunctionType>(texp)) {
+    std::vector<asgbin::TypeRef> params;
+    params.reserve(p->params.size());
+    for (auto&& i : p->params)
+      params.push_back(type(i));
+    rec.mA = mParams.size();
+    rec.mB = params.size();
+    mParams.insert(mParams.end(), params.begin(), params.end());
+  } else
+    ABORT();
+
+  mTypes.push_back(rec);
+  return mTypeIds[texp] = mTypes.size();
+}
+
+asgbin::TypeRef
+Asg2Bin::type(const Type& type)
+{
+  asgbin::TypeRef ret{};
+  ret.mSpec = std::uint8_t(type.spec);
+  ret.mQual = std::uint8_t(type.qual);
+  ret.mTexp = texp(type.texp);
+  return ret;
+}
+
+std::uint32_t
+Asg2Bin::ref(Obj* obj)
+{
+  if (obj == nullptr)
+    return 0;
+  auto& ret = mNodeIds[obj];
+  if (ret == 0) {
+    mNodes.emplace_back();
+    ret = mNodes.size();
+    mPending.push_back(obj);
+  }
+  return ret;
+}
+
+template<typename T>
+void
+Asg2Bin::list(asgbin::NodeRec& rec, const std::vector<T*>& objs)
+{
+  rec.mB = mLists.size();
+  rec.mC = objs.size();
+  for (auto&& i : objs)
+    mLists.push_back(ref(i));
+}
+
+void
+Asg2Bin::fill(Obj* obj)
+{
+  // ref() 会往 mNodes 中追加，先在局部填好再放回去
+  asgbin::NodeRec rec{};
+  rec.mKind = std::uint8_t(obj->tag);
+
+  if (auto p = dyn_cast<Expr>(obj)) {
+    rec.mType = type(p->type);
+    rec.mCate = std::uint8_t(p->cate);
+  } else if (auto p = dyn_cast<Decl>(obj)) {
+    rec.mType = type(p->type);
+    rec.mName = str(p->name);
+  }
+
+  switch (obj->tag) {
+    case Obj::Kind::kIntegerLiteral: {
+      auto p = cast<IntegerLiteral>(obj);
+      rec.mA = std::uint32_t(p->val);
+      rec.mB = std::uint32_t(p->val >> 32);
+      break;
+    }
+
+    case Obj::Kind::kStringLiteral:
+      rec.mName = str(cast<StringLiteral>(obj)->val);
+      break;
+
+    case Obj::Kind::kDeclRefExpr:
+      rec.mA = ref(cast<DeclRefExpr>(obj)->decl);
+      break;
+
+    case Obj::Kind::kParenExpr:
+      rec.mA = ref(cast<ParenExpr>(obj)->sub);
+      break;
+
+    case Obj::Kind::kUnaryExpr: {
+      auto p = cast<UnaryExpr>(obj);
+      rec.mOp = p->op;
+      rec.mA = ref(p->sub);
+      break;
+    }
+
+    case Obj::Kind::kBinaryExpr: {
+      auto p = cast<BinaryExpr>(obj);
+      rec.mOp = p->op;
+      rec.mA = ref(p->lft);
+      rec.mB = ref(p->rht);
+      break;
+    }
+
+    case Obj::Kind::kCallExpr: {
+      auto p = cast<CallExpr>(obj);
+      rec.mA = ref(p->head);
+      list(rec, p->args);
+      break;
+    }
+
+    case Obj::Kind::kInitListExpr:
+      list(rec, cast<InitListExpr>(obj)->list);
+      break;
+
+    case Obj::Kind::kImplicitInitExpr:
+      break;
+
+    case Obj::Kind::kImplicitCastExpr: {
+      auto p = cast<ImplicitCastExpr>(obj);
+      rec.mOp = p->kind;
+      rec.mA = ref(p->sub);
+      break;
+    }
+
+    case Obj::Kind::kNullStmt:
+      break;
+
+    case Obj::Kind::kDeclStmt:
+      list(rec, cast<DeclStmt>(obj)->decls);
+      break;
+
+    case Obj::Kind::kExprStmt:
+      rec.mA = ref(cast<ExprStmt>(obj)->expr);
+      break;
+
+    case Obj::Kind::kCompoundStmt:
+      list(rec, cast<CompoundStmt>(obj)->subs);
+      break;
+
+    case Obj::Kind::kIfStmt: {
+      auto p = cast<IfStmt>(obj);
+      rec.mA = ref(p->cond);
+      rec.mB = ref(p->then);
+      rec.mC = ref(p->else_);
+      break;
+    }
+
+    case Obj::Kind::kWhileStmt: {
+      auto p = cast<WhileStmt>(obj);
+      rec.mA = ref(p->cond);
+      rec.mB = ref(p->body);
+      break;
+    }
+
+    case Obj::Kind::kDoStmt: {
+      auto p = cast<DoStmt>(obj);
+      rec.mA = ref(p->cond);
+      rec.mB = ref(p->body);
+      break;
+    }
+
+    case Obj::Kind::kBreakStmt:
+      rec.mA = ref(cast<BreakStmt>(obj)->loop);
+      break;
+
+    case Obj::Kind::kContinueStmt:
+      rec.mA = ref(cast<ContinueStmt>(obj)->loop);
+      break;
+
+    case Obj::Kind::kReturnStmt: {
+      auto p = cast<ReturnStmt>(obj);
+      rec.mA = ref(p->expr);
+      rec.mB = ref(p->func);
+      break;
+    }
+
+    case Obj::Kind::kVarDecl:
+      rec.mA = ref(cast<VarDecl>(obj)->init);
+      break;
+
+    case Obj::Kind::kFunctionDecl: {
+      auto p = cast<FunctionDecl>(obj);
+      rec.mA = ref(p->body);
+      list(rec, p->params);
+      break;
+    }
+
+    default:
+      ABORT();
+  }
+
+  mNodes[mNodeIds[obj] - 1] = rec;
+}
+
+void
+Asg2Bin::write()
+{
+  asgbin::Header header{};
+  std::memcpy(header.mMagic, asgbin::kMagic, sizeof(header.mMagic));
+  header.mVersion = asgbin::kVersion;
+  header.mByteOrder = asgbin::kByteOrder;
+
+  struct Part
+  {
+    asgbin::Section& mSection;
+    const void* mData;
+    std::size_t mBytes;
+  };
+
+  auto part = [](asgbin::Section& section, auto& vec) {
+    section.mCount = vec.size();
+    return Part{ section, vec.data(), vec.size() * sizeof(vec[0]) };
+  };
+
+  Part parts[] = {
+    part(header.mStrings, mStrings), part(header.mChars, mChars),
+    part(header.mTypes, mTypes),     part(header.mParams, mParams),
+    part(header.mNodes, mNodes),     part(header.mLists, mLists),
+    part(header.mTop, mTop),
+  };
+
+  std::uint64_t offset = sizeof(header);
+  for (auto&& i : parts) {
+    offset = asgbin::align8(offset);
+    i.mSection.mOffset = offset;
+    offset += i.mBytes;
+  }
+
+  mOs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  offset = sizeof(header);
+  for (auto&& i : parts) {
+    mOs.write_zeros(i.mSection.mOffset - offset);
+    mOs.write(static_cast<const char*>(i.mData), i.mBytes);
+    offset = i.mSection.mOffset + i.mBytes;
+  }
+}
+
+} // namespace asg
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "asg.hpp"
+#include "asgbin.hpp"
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+namespace asg {
+
+/**
+ * @brief 把语义图写成 asgbin.hpp 中的二进制格式，实验三可以用 --format=bin
+ * 直接读入，不必再解析 JSON。
+ *
+ * 节点第一次被引用时分到下标，放进待写的工作表，之后逐个填写，所以
+ * BreakStmt::loop 等指回祖先的引用不需要特殊处理。类型表达式已经唯一化，每个
+ * 只写一次；名字和字符串常量按 Atom 去重。
+ */
+class Asg2Bin
+{
+public:
+  explicit Asg2Bin(llvm::raw_ostream& os)
+    : mOs(os)
+  {
+  }
+
+  void operator()(TranslationUnit& tu);
+
+private:
+  llvm::raw_ostream& mOs;
+
+  std::vector<asgbin::Str> mStrings;
+  std::string mChars;
+  std::vector<asgbin::TypeRec> mTypes;
+  std::vector<asgbin::TypeRef> mParams;
+  std::vector<asgbin::NodeRec> mNodes;
+  std::vector<std::uint32_t> mLists;
+  std::vector<std::uint32_t> mTop;
+
+  std::vector<std::uint32_t> mStrIds; // 以 Atom 的编号为下标，0 表示还没有写
+  Obj::Table<std::uint32_t> mTypeIds; // 类型表达式的引用，0 表示还没有写
+  Obj::Table<std::uint32_t> mNodeIds; // 节点的引用，0 表示还没有分配
+
+  std::vector<Obj*> mPending; // 已分配下标、还没有填写的节点
+
+  std::uint32_t str(atom::Atom atom);
+
+  std::uint32_t texp(TypeExpr* texp);
+
+  asgbin::TypeRef type(const Type& type);
+
+  /// 节点的引用，第一次遇到时分配下标并加入 mPending
+  std::uint32_t ref(Obj* obj);
+
+  /// 把一组节点的引用追加到 mLists，填入 rec 的 mB、mC
+  template<typename T>
+  void list(asgbin::NodeRec& rec, const std::vector<T*>& objs);
+
+  /// 填写 obj 的记录
+  void fill(Obj* obj);
+
+  void write();
+};
+
+} // namespace asg
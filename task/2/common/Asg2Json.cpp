@@ -4,19 +4,16 @@
 
 namespace asg {
 
-json::Object
+void
 Asg2Json::operator()(TranslationUnit& tu)
 {
-  json::Object ret;
-
-  ret["kind"] = "TranslationUnitDecl";
-
-  json::Array inner;
-  for (auto&& i : tu)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      for (auto&& i : tu)
+        self(i);
+    });
+    mOs.attribute("kind", "TranslationUnitDecl");
+  });
 }
 
 //==============================================================================
@@ -26,9 +23,9 @@ Asg2Json::operator()(TranslationUnit& tu)
 std::string
 Asg2Json::operator()(TypeExpr* texp)
 {
-  Obj::Walked guard(texp);
+  Obj::Walked guard(mWalked, texp);
 
-  if (auto p = texp->dcst<ArrayType>()) {
+  if (auto p = dyn_cast<ArrayType>(texp)) {
     std::string ret = "[";
 
     if (p->len != ArrayType::kUnLen)
@@ -41,7 +38,7 @@ Asg2Json::operator()(TypeExpr* texp)
     return ret;
   }
 
-  if (auto p = texp->dcst<FunctionType>()) {
+  if (auto p = dyn_cast<FunctionType>(texp)) {
     std::string ret;
 
     if (texp->sub != nullptr)
@@ -51,7 +48,7 @@ Asg2Json::operator()(TypeExpr* texp)
     if (!p->params.empty()) {
       auto it = p->params.begin(), end = p->params.end();
       while (true) {
-        ret += self((*it)->type);
+        ret += self(*it);
         if (++it == end)
           break;
         ret += ", ";
@@ -65,9 +62,13 @@ Asg2Json::operator()(TypeExpr* texp)
   ABORT();
 }
 
-std::string
+const std::string&
 Asg2Json::operator()(const Type& type)
 {
+  auto iter = mTypeNames.find(type);
+  if (iter != mTypeNames.end())
+    return iter->second;
+
   std::string ret;
 
   switch (type.qual) {
@@ -114,99 +115,68 @@ Asg2Json::operator()(const Type& type)
   if (type.texp)
     ret += self(type.texp);
 
-  return ret;
+  // 拼接参数类型时可能已经插入了别的类型，这里不能复用上面的 iter
+  return mTypeNames.emplace(type, std::move(ret)).first->second;
 }
 
 //==============================================================================
 // 表达式
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Expr* obj)
 {
-  json::Object ret;
-
-  if (auto p = obj->dcst<IntegerLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<StringLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<DeclRefExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<DeclRefExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ParenExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<UnaryExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<BinaryExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<CallExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<InitListExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitInitExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitCastExpr>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
-
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
-
-  switch (obj->cate) {
-    case Expr::Cate::kINVALID:
-      ret["valueCategory"] = "INVALID";
-      break;
-
-    case Expr::Cate::kLValue:
-      ret["valueCategory"] = "lvalue";
-      break;
+  mOs.object([&] {
+    visit(obj, [&](auto p) { self(p); });
+
+    mOs.attributeObject("type", [&] {
+      mOs.attribute("qualType", llvm::StringRef(self(obj->type)));
+    });
+
+    // 字面量的 value 排在 type 之后，只能在这里写
+    if (auto p = dyn_cast<IntegerLiteral>(obj))
+      mOs.attribute("value", std::to_string(p->val));
+    else if (dyn_cast<StringLiteral>(obj))
+      mOs.attribute("value", llvm::StringRef(mEscaped));
+
+    switch (obj->cate) {
+      case Expr::Cate::kINVALID:
+        mOs.attribute("valueCategory", "INVALID");
+        break;
 
-    case Expr::Cate::kRValue:
-      ret["valueCategory"] = "pralue";
-      break;
+      case Expr::Cate::kLValue:
+        mOs.attribute("valueCategory", "lvalue");
+        break;
 
-    default:
-      ABORT();
-  }
+      case Expr::Cate::kRValue:
+        mOs.attribute("valueCategory", "pralue");
+        break;
 
-  return ret;
+      default:
+        ABORT();
+    }
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(IntegerLiteral* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "IntegerLiteral";
-  ret["value"] = std::to_string(obj->val);
-
-  return ret;
+  mOs.attribute("kind", "IntegerLiteral");
 }
 
-json::Object
+void
 Asg2Json::operator()(StringLiteral* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "StringLiteral";
+  mOs.attribute("kind", "StringLiteral");
 
-  std::string value;
+  auto& value = mEscaped;
+  value.clear();
   value.push_back('"');
-  for (auto&& c : obj->val) {
+  for (auto&& c : obj->val.view()) {
     switch (c) {
       case '\'':
         value += "\\'";
@@ -257,456 +227,374 @@ Asg2Json::operator()(StringLiteral* obj)
     }
   }
   value.push_back('"');
-  ret["value"] = std::move(value);
-
-  return ret;
 }
 
-json::Object
+void
 Asg2Json::operator()(DeclRefExpr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "DeclRefExpr";
-
-  return ret;
+  mOs.attribute("kind", "DeclRefExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(ParenExpr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "ParenExpr";
+  Obj::Walked guard(mWalked, obj);
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
+  mOs.attributeArray("inner", [&] { self(obj->sub); });
 
-  return ret;
+  mOs.attribute("kind", "ParenExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(UnaryExpr* obj)
 {
   assert(obj->sub);
 
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "UnaryOperator";
+  mOs.attributeArray("inner", [&] { self(obj->sub); });
+
+  mOs.attribute("kind", "UnaryOperator");
 
   switch (obj->op) {
     case UnaryExpr::kPos:
-      ret["opcode"] = "+";
+      mOs.attribute("opcode", "+");
       break;
 
     case UnaryExpr::kNeg:
-      ret["opcode"] = "-";
+      mOs.attribute("opcode", "-");
       break;
 
     case UnaryExpr::kNot:
-      ret["opcode"] = "!";
+      mOs.attribute("opcode", "!");
       break;
 
     default:
       ABORT();
   }
-
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
-
-  return ret;
 }
 
-json::Object
+void
 Asg2Json::operator()(BinaryExpr* obj)
 {
   assert(obj->lft && obj->rht);
 
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "BinaryOperator";
+  mOs.attributeArray("inner", [&] {
+    self(obj->lft);
+    self(obj->rht);
+  });
 
+  const char* opcode = nullptr;
   switch (obj->op) {
     case BinaryExpr::kMul:
-      ret["opcode"] = "*";
+      opcode = "*";
       break;
 
     case BinaryExpr::kDiv:
-      ret["opcode"] = "/";
+      opcode = "/";
       break;
 
     case BinaryExpr::kMod:
-      ret["opcode"] = "%";
+      opcode = "%";
       break;
 
     case BinaryExpr::kAdd:
-      ret["opcode"] = "+";
+      opcode = "+";
       break;
 
     case BinaryExpr::kSub:
-      ret["opcode"] = "-";
+      opcode = "-";
       break;
 
     case BinaryExpr::kGt:
-      ret["opcode"] = ">";
+      opcode = ">";
       break;
 
     case BinaryExpr::kLt:
-      ret["opcode"] = "<";
+      opcode = "<";
       break;
 
     case BinaryExpr::kGe:
-      ret["opcode"] = ">=";
+      opcode = ">=";
       break;
 
     case BinaryExpr::kLe:
-      ret["opcode"] = "<=";
+      opcode = "<=";
       break;
 
     case BinaryExpr::kEq:
-      ret["opcode"] = "==";
+      opcode = "==";
       break;
 
     case BinaryExpr::kNe:
-      ret["opcode"] = "!=";
+      opcode = "!=";
       break;
 
     case BinaryExpr::kAnd:
-      ret["opcode"] = "&&";
+      opcode = "&&";
       break;
 
     case BinaryExpr::kOr:
-      ret["opcode"] = "||";
+      opcode = "||";
       break;
 
     case BinaryExpr::kAssign:
-      ret["opcode"] = "=";
+      opcode = "=";
       break;
 
     case BinaryExpr::kComma:
-      ret["opcode"] = ",";
+      opcode = ",";
       break;
 
     case BinaryExpr::kIndex:
-      ret["kind"] = "ArraySubscriptExpr";
       break;
 
     default:
       ABORT();
   }
 
-  json::Array inner;
-  inner.push_back(self(obj->lft));
-  inner.push_back(self(obj->rht));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  if (opcode) {
+    mOs.attribute("kind", "BinaryOperator");
+    mOs.attribute("opcode", opcode);
+  } else
+    mOs.attribute("kind", "ArraySubscriptExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(CallExpr* obj)
 {
   assert(obj->head);
 
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "CallExpr";
+  Obj::Walked guard(mWalked, obj);
 
-  json::Array inner;
-  inner.push_back(self(obj->head));
-  for (auto&& i : obj->args)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  mOs.attributeArray("inner", [&] {
+    self(obj->head);
+    for (auto&& i : obj->args)
+      self(i);
+  });
 
-  return ret;
+  mOs.attribute("kind", "CallExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(InitListExpr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "InitListExpr";
+  mOs.attributeArray("inner", [&] {
+    for (auto&& i : obj->list)
+      self(i);
+  });
 
-  json::Array inner;
-  for (auto&& i : obj->list)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOs.attribute("kind", "InitListExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(ImplicitInitExpr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "InitListExpr";
+  Obj::Walked guard(mWalked, obj);
 
-  return ret;
+  mOs.attribute("kind", "InitListExpr");
 }
 
-json::Object
+void
 Asg2Json::operator()(ImplicitCastExpr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "ImplicitCastExpr";
+  mOs.attributeArray("inner", [&] { self(obj->sub); });
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOs.attribute("kind", "ImplicitCastExpr");
 }
 
 //==============================================================================
 // 语句
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Stmt* obj)
 {
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (typeid(*obj) == typeid(Stmt)) {
-    json::Object ret;
-    ret["kind"] = "NullStmt";
-    return ret;
-  }
-
-  ABORT();
+  visit(obj, [&](auto p) {
+    using T = std::remove_pointer_t<decltype(p)>;
+    if constexpr (std::is_same_v<T, NullStmt>)
+      mOs.object([&] { mOs.attribute("kind", "NullStmt"); });
+    else
+      self(p);
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(DeclStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "DeclStmt";
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      for (auto&& i : obj->decls)
+        self(i);
+    });
 
-  json::Array inner;
-  for (auto&& i : obj->decls)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+    mOs.attribute("kind", "DeclStmt");
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(ExprStmt* obj)
 {
   assert(obj->expr);
-  return self(obj->expr);
+  self(obj->expr);
 }
 
-json::Object
+void
 Asg2Json::operator()(CompoundStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "CompoundStmt";
+  Obj::Walked guard(mWalked, obj);
 
-  json::Array inner;
-  for (auto&& i : obj->subs)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      for (auto&& i : obj->subs)
+        self(i);
+    });
 
-  return ret;
+    mOs.attribute("kind", "CompoundStmt");
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(IfStmt* obj)
 {
   assert(obj->cond && obj->then);
 
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "IfStmt";
+  Obj::Walked guard(mWalked, obj);
 
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->then));
-  if (obj->else_)
-    inner.push_back(self(obj->else_));
-  ret["inner"] = std::move(inner);
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      self(obj->cond);
+      self(obj->then);
+      if (obj->else_)
+        self(obj->else_);
+    });
 
-  return ret;
+    mOs.attribute("kind", "IfStmt");
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(WhileStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "WhileStmt";
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      self(obj->cond);
+      self(obj->body);
+    });
 
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->body));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+    mOs.attribute("kind", "WhileStmt");
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(DoStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "DoStmt";
+  Obj::Walked guard(mWalked, obj);
 
-  json::Array inner;
-  inner.push_back(self(obj->body));
-  inner.push_back(self(obj->cond));
-  ret["inner"] = std::move(inner);
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      self(obj->body);
+      self(obj->cond);
+    });
 
-  return ret;
+    mOs.attribute("kind", "DoStmt");
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(BreakStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "BreakStmt";
-
-  return ret;
+  mOs.object([&] { mOs.attribute("kind", "BreakStmt"); });
 }
 
-json::Object
+void
 Asg2Json::operator()(ContinueStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "ContinueStmt";
+  Obj::Walked guard(mWalked, obj);
 
-  return ret;
+  mOs.object([&] { mOs.attribute("kind", "ContinueStmt"); });
 }
 
-json::Object
+void
 Asg2Json::operator()(ReturnStmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "ReturnStmt";
+  mOs.object([&] {
+    mOs.attributeArray("inner", [&] {
+      if (obj->expr)
+        self(obj->expr);
+    });
 
-  json::Array inner;
-  if (obj->expr)
-    inner.push_back(self(obj->expr));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+    mOs.attribute("kind", "ReturnStmt");
+  });
 }
 
 //==============================================================================
 // 声明
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Decl* obj)
 {
-  json::Object ret;
-
-  if (auto p = obj->dcst<VarDecl>())
-    ret = std::move(self(p));
+  mOs.object([&] {
+    visit(obj, [&](auto p) { self(p); });
 
-  else if (auto p = obj->dcst<FunctionDecl>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
-
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
-
-  return ret;
+    mOs.attributeObject("type", [&] {
+      mOs.attribute("qualType", llvm::StringRef(self(obj->type)));
+    });
+  });
 }
 
-json::Object
+void
 Asg2Json::operator()(VarDecl* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  Obj::Walked guard(mWalked, obj);
 
-  ret["kind"] = "VarDecl";
+  mOs.attributeArray("inner", [&] {
+    if (obj->init)
+      self(obj->init);
+  });
 
-  ret["name"] = obj->name;
+  mOs.attribute("kind", "VarDecl");
 
-  json::Array inner;
-  if (obj->init)
-    inner.push_back(self(obj->init));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOs.attribute("name", llvm::StringRef(obj->name.view()));
 }
 
-json::Object
+void
 Asg2Json::operator()(FunctionDecl* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "FunctionDecl";
-
-  ret["name"] = obj->name;
-
-  json::Array inner;
-  for (auto&& i : obj->params) {
-    json::Object pobj;
-    pobj["kind"] = "ParmVarDecl";
-    pobj["name"] = i->name;
-    inner.push_back(std::move(pobj));
-  }
+  Obj::Walked guard(mWalked, obj);
+
+  mOs.attributeArray("inner", [&] {
+    for (auto&& i : obj->params) {
+      mOs.object([&] {
+        mOs.attribute("kind", "ParmVarDecl");
+        mOs.attribute("name", llvm::StringRef(i->name.view()));
+      });
+    }
 
-  if (obj->body)
-    inner.push_back(self(obj->body));
+    if (obj->body)
+      self(obj->body);
+  });
 
-  ret["inner"] = std::move(inner);
+  mOs.attribute("kind", "FunctionDecl");
 
-  return ret;
+  mOs.attribute("name", llvm::StringRef(obj->name.view()));
 }
 
 } // namespace asg
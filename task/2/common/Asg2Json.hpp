@@ -1,83 +1,116 @@
 #include "asg.hpp"
 #include <llvm/Support/JSON.h>
+#include <string>
+#include <unordered_map>
 
 namespace asg {
 
 namespace json = llvm::json;
 
+/**
+ * @brief 边遍历语义图边通过 json::OStream 写出 JSON，不在内存中构建整棵 JSON
+ * 树，额外的内存只与树的深度有关。
+ *
+ * json::Object 输出时按键排序，为了与原先的输出逐字节相同，每个对象的键都按
+ * inner、kind、name、opcode、type、value、valueCategory 的顺序写出。表达式和
+ * 声明的对象由 operator()(Expr*)、operator()(Decl*) 打开，各节点只写排在 type
+ * 之前的键；语句的对象由各节点自己打开。
+ */
 class Asg2Json
 {
 public:
-  json::Object operator()(TranslationUnit& tu);
+  explicit Asg2Json(json::OStream& os)
+    : mOs(os)
+  {
+  }
+
+  void operator()(TranslationUnit& tu);
 
 private:
+  json::OStream& mOs;
+  Obj::Table<bool> mWalked;
+
   //============================================================================
   // 类型
   //============================================================================
 
+  struct TypeHash
+  {
+    std::size_t operator()(const Type& type) const
+    {
+      return std::hash<TypeExpr*>()(type.texp) ^
+             (std::size_t(type.spec) << 1 | std::size_t(type.qual));
+    }
+  };
+
+  /// 类型已经唯一化，同一个类型的字符串只拼接一次
+  std::unordered_map<Type, std::string, TypeHash> mTypeNames;
+
   std::string operator()(TypeExpr* texp);
 
-  std::string operator()(const Type& type);
+  const std::string& operator()(const Type& type);
 
   //============================================================================
   // 表达式
   //============================================================================
 
-  json::Object operator()(Expr* obj);
+  std::string mEscaped; // 字符串常量转义后的文本，反复使用同一块缓冲
+
+  void operator()(Expr* obj);
 
-  json::Object operator()(IntegerLiteral* obj);
+  void operator()(IntegerLiteral* obj);
 
-  json::Object operator()(StringLiteral* obj);
+  void operator()(StringLiteral* obj);
 
-  json::Object operator()(ParenExpr* obj);
+  void operator()(ParenExpr* obj);
 
-  json::Object operator()(DeclRefExpr* obj);
+  void operator()(DeclRefExpr* obj);
 
-  json::Object operator()(UnaryExpr* obj);
+  void operator()(UnaryExpr* obj);
 
-  json::Object operator()(BinaryExpr* obj);
+  void operator()(BinaryExpr* obj);
 
-  json::Object operator()(CallExpr* obj);
+  void operator()(CallExpr* obj);
 
-  json::Object operator()(InitListExpr* obj);
+  void operator()(InitListExpr* obj);
 
-  json::Object operator()(ImplicitInitExpr* obj);
+  void operator()(ImplicitInitExpr* obj);
 
-  json::Object operator()(ImplicitCastExpr* obj);
+  void operator()(ImplicitCastExpr* obj);
 
   //============================================================================
   // 语句
   //============================================================================
 
-  json::Object operator()(Stmt* obj);
+  void operator()(Stmt* obj);
 
-  json::Object operator()(DeclStmt* obj);
+  void operator()(DeclStmt* obj);
 
-  json::Object operator()(ExprStmt* obj);
+  void operator()(ExprStmt* obj);
 
-  json::Object operator()(CompoundStmt* obj);
+  void operator()(CompoundStmt* obj);
 
-  json::Object operator()(IfStmt* obj);
+  void operator()(IfStmt* obj);
 
-  json::Object operator()(WhileStmt* obj);
+  void operator()(WhileStmt* obj);
 
-  json::Object operator()(DoStmt* obj);
+  void operator()(DoStmt* obj);
 
-  json::Object operator()(BreakStmt* obj);
+  void operator()(BreakStmt* obj);
 
-  json::Object operator()(ContinueStmt* obj);
+  void operator()(ContinueStmt* obj);
 
-  json::Object operator()(ReturnStmt* obj);
+  void operator()(ReturnStmt* obj);
 
   //============================================================================
   // 声明
   //============================================================================
 
-  json::Object operator()(Decl* obj);
+  void operator()(Decl* obj);
 
-  json::Object operator()(VarDecl* obj);
+  void operator()(VarDecl* obj);
 
-  json::Object operator()(FunctionDecl* obj);
+  void operator()(FunctionDecl* obj);
 };
 
 } // namespace asg
@@ -19,31 +19,22 @@ Typing::operator()(TranslationUnit& tu)
 Expr*
 Typing::operator()(Expr* obj)
 {
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<StringLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<DeclRefExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ParenExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<UnaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<BinaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<CallExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ImplicitCastExpr>())
-    return self(p->sub);
-
-  ABORT();
+  return visit(obj, [&](auto p) -> Expr* {
+    using T = std::remove_pointer_t<decltype(p)>;
+    if constexpr (std::is_same_v<T, ImplicitCastExpr>)
+      return self(p->sub);
+    else if constexpr (is_one_of<T,
+                                 IntegerLiteral,
+                                 StringLiteral,
+                                 DeclRefExpr,
+                                 ParenExpr,
+                                 UnaryExpr,
+                                 BinaryExpr,
+                                 CallExpr>::value)
+      return self(p);
+    else
+      ABORT();
+  });
 }
 
 Expr*
@@ -67,14 +58,7 @@ Typing::operator()(StringLiteral* obj)
   obj->type.spec = Type::Spec::kChar;
   obj->type.qual = Type::Qual::kConst;
 
-  if (obj->type.texp == nullptr ||
-      typeid(*obj->type.texp) != typeid(ArrayType)) {
-    auto& t = make<ArrayType>();
-    obj->type.texp = &t;
-  }
-  auto arrTy = obj->type.texp->scst<ArrayType>();
-  arrTy->sub = nullptr;
-  arrTy->len = obj->val.size() + 1;
+  obj->type.texp = mTypes.array(nullptr, obj->val.size() + 1);
 
   obj->cate = Expr::Cate::kRValue;
   return obj;
@@ -84,7 +68,7 @@ Expr*
 Typing::operator()(DeclRefExpr* obj)
 {
   ASSERT(obj->decl);
-  Obj::Walked walked(obj);
+  Obj::Walked walked(mWalked, obj);
 
   // C语言要求符号先声明后使用，所以此处无需再进入类型检查。
   // 另外，如果真的进入了，可能会导致无限递归。
@@ -109,7 +93,7 @@ Expr*
 Typing::operator()(UnaryExpr* obj)
 {
   ASSERT(obj->sub);
-  Obj::Walked walked(obj);
+  Obj::Walked walked(mWalked, obj);
 
   auto sub = self(obj->sub);
   // 左值要先转成右值，然后进行整数提升
@@ -140,7 +124,7 @@ Expr*
 Typing::operator()(BinaryExpr* obj)
 {
   ASSERT(obj->lft && obj->rht);
-  Obj::Walked walked(obj);
+  Obj::Walked walked(mWalked, obj);
 
   auto lft = self(obj->lft);
   auto rht = self(obj->rht);
@@ -215,7 +199,7 @@ Typing::operator()(BinaryExpr* obj)
     } break;
 
     case BinaryExpr::kIndex: {
-      auto arrayType = lft->type.texp->dcst<ArrayType>();
+      auto arrayType = dyn_cast<ArrayType>(lft->type.texp);
       if (arrayType == nullptr)
         ABORT();
 
@@ -256,7 +240,7 @@ Typing::operator()(CallExpr* obj)
   ASSERT(obj->head);
 
   obj->head = self(obj->head);
-  auto fexp = dynamic_cast<FunctionType*>(obj->head->type.texp);
+  auto fexp = dyn_cast<FunctionType>(obj->head->type.texp);
   if (fexp == nullptr)
     ABORT();
 
@@ -271,7 +255,7 @@ Typing::operator()(CallExpr* obj)
 
   for (int i = fexp->params.size(); --i != -1;) {
     Expr lft;
-    lft.type = fexp->params[i]->type;
+    lft.type = fexp->params[i];
     lft.cate = Expr::Cate::kLValue;
     obj->args[i] = assigment_cast(&lft, self(obj->args[i]));
   }
@@ -291,37 +275,11 @@ Typing::operator()(CallExpr* obj)
 void
 Typing::operator()(Stmt* obj)
 {
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (typeid(*obj) == typeid(Stmt))
-    return;
-
-  ABORT();
+  visit(obj, [&](auto p) {
+    using T = std::remove_pointer_t<decltype(p)>;
+    if constexpr (!std::is_same_v<T, NullStmt>)
+      self(p);
+  });
 }
 
 void
@@ -381,7 +339,7 @@ void
 Typing::operator()(ReturnStmt* obj)
 {
   auto& ftype = obj->func->type;
-  auto ftexp = dynamic_cast<FunctionType*>(ftype.texp);
+  auto ftexp = dyn_cast<FunctionType>(ftype.texp);
   if (ftexp == nullptr || ftexp->sub != nullptr)
     ABORT();
 
@@ -417,13 +375,7 @@ Typing::operator()(ReturnStmt* obj)
 void
 Typing::operator()(Decl* obj)
 {
-  if (auto p = obj->dcst<VarDecl>())
-    return self(p);
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
-
-  ABORT();
+  visit(obj, [&](auto p) { self(p); });
 }
 
 void
@@ -467,15 +419,12 @@ Typing::operator()(FunctionDecl* obj)
   // 必须为函数类型
   if (obj->type.texp == nullptr)
     ABORT();
-  auto funcType = obj->type.texp->dcst<FunctionType>();
+  auto funcType = dyn_cast<FunctionType>(obj->type.texp);
   if (funcType == nullptr)
     ABORT();
 
-  funcType->params.resize(obj->params.size());
-  for (int i = obj->params.size(); --i != -1;) {
+  for (int i = obj->params.size(); --i != -1;)
     self(obj->params[i]);
-    funcType->params[i] = obj->params[i];
-  }
 
   if (obj->body) {
     for (auto&& i : obj->body->subs)
@@ -490,7 +439,7 @@ Typing::operator()(FunctionDecl* obj)
 Expr*
 Typing::ensure_rvalue(Expr* exp)
 {
-  if (exp->type.texp->dcst<ArrayType>()) {
+  if (dyn_cast<ArrayType>(exp->type.texp)) {
     auto& cst = make<ImplicitCastExpr>();
     cst.kind = cst.kArrayToPointerDecay;
 
@@ -553,64 +502,6 @@ Typing::promote_integer(Expr* exp, Type::Spec to)
   }
 }
 
-static bool
-type_equal(Type& a, const Type& b);
-
-static bool
-typeexpr_equal(TypeExpr* a, TypeExpr* b)
-{
-  if (a == b)
-    return true;
-  if (a == nullptr)
-    return b == nullptr;
-  if (b == nullptr)
-    return false;
-  if (typeid(*a) != typeid(*b))
-    return false;
-
-  if (auto at = a->dcst<PointerType>()) {
-    auto bt = b->scst<PointerType>();
-    if (at->qual != bt->qual)
-      return false;
-    return typeexpr_equal(at->sub, bt->sub);
-  }
-
-  if (auto at = a->dcst<ArrayType>()) {
-    auto bt = b->scst<ArrayType>();
-    return typeexpr_equal(at->sub, bt->sub);
-  }
-
-  if (auto at = a->dcst<FunctionType>()) {
-    auto bt = b->dcst<FunctionType>();
-    if (at->params.size() != bt->params.size())
-      return false;
-
-    for (int i = at->params.size(); --i != -1;) {
-      if (!type_equal(at->params[i]->type, bt->params[i]->type))
-        return false;
-    }
-    return true;
-  }
-
-  ABORT(); // 未知的 Type 子类型
-}
-
-static bool
-type_equal(Type& a, const Type& b)
-{
-  if (&a == &b)
-    return true;
-
-  if (a.spec != b.spec || a.qual != b.qual)
-    return false;
-
-  if (!typeexpr_equal(a.texp, b.texp))
-    return false;
-
-  a.texp = b.texp;
-  return true;
-}
-
 Expr*
 Typing::assigment_cast(Expr* lft, Expr* rht)
 {
@@ -641,7 +532,8 @@ Typing::assigment_cast(Expr* lft, Expr* rht)
   rht = ensure_rvalue(rht); // 只能赋右值给变量
 
   if (lft->type.texp != nullptr) {
-    if (!lft->type.texp->dcst<ArrayType>())
+    auto lftArr = dyn_cast<ArrayType>(lft->type.texp);
+    if (!lftArr)
       ABORT(); // 最多只支持数组类型被赋值
 
     if (lft->type.qual == Type::Qual::kConst) {
@@ -653,8 +545,14 @@ Typing::assigment_cast(Expr* lft, Expr* rht)
       rht = &ccst;
     }
 
-    // 除了 const 可兼容之外，赋值类型必须相同
-    if (!type_equal(lft->type, rht->type))
+    // 除了 const 可兼容之外，赋值类型必须相同，但不比较最外层数组的长度：
+    // 实参 int a[10] 可以传给形参 int arr[]。内层的长度必须相同，int[2][3]
+    // 不能传给 int a[][4]（C 中两者的指针类型不兼容），这比哈希共享之前的
+    // typeexpr_equal 严格，后者忽略所有层的长度
+    auto rhtArr = dyn_cast<ArrayType>(rht->type.texp);
+    if (lft->type.spec != rht->type.spec ||
+        lft->type.qual != rht->type.qual || !rhtArr ||
+        lftArr->sub != rhtArr->sub)
       ABORT();
   }
 
@@ -673,16 +571,16 @@ Typing::assigment_cast(Expr* lft, Expr* rht)
 }
 
 Expr*
-Typing::infer_init(Expr* init, const Type& to)
+Typing::infer_init(Expr* init, Type& to)
 {
   // https://zh.cppreference.com/w/c/language/scalar_initialization
   if (to.texp == nullptr) {
-    if (auto p = init->dcst<ImplicitInitExpr>()) {
+    if (auto p = dyn_cast<ImplicitInitExpr>(init)) {
       p->type = to;
       return p;
     }
 
-    if (auto p = init->dcst<InitListExpr>()) {
+    if (auto p = dyn_cast<InitListExpr>(init)) {
       // 用多个值初始化一个变量时，只有第一个有用，其余的被忽略。
       if (!p->list.empty())
         return infer_init(p->list[0], to);
@@ -700,14 +598,14 @@ Typing::infer_init(Expr* init, const Type& to)
   }
 
   // https://zh.cppreference.com/w/c/language/array_initialization
-  if (auto arrTy = to.texp->dcst<ArrayType>()) {
-    if (auto p = init->dcst<ImplicitInitExpr>()) {
+  if (auto arrTy = dyn_cast<ArrayType>(to.texp)) {
+    if (auto p = dyn_cast<ImplicitInitExpr>(init)) {
       p->type = to;
       return p;
     }
 
     // 从花括号环绕列表初始化
-    if (auto initList = init->dcst<InitListExpr>()) {
+    if (auto initList = dyn_cast<InitListExpr>(init)) {
       auto [ret, _] = infer_initlist(initList->list, 0, to);
       return ret;
     }
@@ -716,13 +614,13 @@ Typing::infer_init(Expr* init, const Type& to)
     if (to.spec == Type::Spec::kChar) {
       init = self(init);
 
-      auto p = init->type.texp->dcst<ArrayType>();
+      auto p = dyn_cast<ArrayType>(init->type.texp);
       if (!p || p->sub != nullptr || init->type.spec != Type::Spec::kChar)
         ABORT();
-      if (arrTy->len == -1)
-        arrTy->len = p->len;
+      if (arrTy->len == ArrayType::kUnLen)
+        to.texp = p;
       else
-        p->len = arrTy->len;
+        init->type.texp = mTypes.array(nullptr, arrTy->len);
 
       return init;
     }
@@ -736,7 +634,7 @@ Typing::infer_init(Expr* init, const Type& to)
 std::pair<Expr*, std::size_t>
 Typing::infer_initlist(const std::vector<Expr*>& list,
                        std::size_t begin,
-                       const Type& to)
+                       Type& to)
 {
   if (to.texp == nullptr) {
     if (begin == list.size())
@@ -746,35 +644,25 @@ Typing::infer_initlist(const std::vector<Expr*>& list,
     return { ret, begin + 1 };
   }
 
-  if (auto arrTy = to.texp->dcst<ArrayType>()) {
+  if (auto arrTy = dyn_cast<ArrayType>(to.texp)) {
     auto& ret = make<InitListExpr>();
-    ret.type = to;
-    ret.type.qual = Type::Qual::kNone;
     ret.cate = Expr::Cate::kRValue;
 
     Type elemTy = to;
     elemTy.texp = arrTy->sub;
 
-    if (arrTy->len == ArrayType::kUnLen) {
-      arrTy->len = 0;
-      while (begin < list.size()) {
-        auto [expr, next] = infer_initlist(list, begin, elemTy);
-        ret.list.push_back(expr);
-        begin = next;
-        ++arrTy->len;
-      }
-    }
-
-    else {
-      for (int i = 0; i < arrTy->len; ++i) {
-        if (begin == list.size())
-          break;
-        auto [expr, next] = infer_initlist(list, begin, elemTy);
-        ret.list.push_back(expr);
-        begin = next;
-      }
+    // 长度未知时用完所有初始化元素，再由元素个数确定长度
+    bool unknown = arrTy->len == ArrayType::kUnLen;
+    while (begin < list.size() && (unknown || ret.list.size() < arrTy->len)) {
+      auto [expr, next] = infer_initlist(list, begin, elemTy);
+      ret.list.push_back(expr);
+      begin = next;
     }
+    if (unknown)
+      to.texp = mTypes.array(arrTy->sub, ret.list.size());
 
+    ret.type = to;
+    ret.type.qual = Type::Qual::kNone;
     return { &ret, begin };
   }
 
@@ -1,4 +1,5 @@
 #include "asg.hpp"
+#include "typectx.hpp"
 
 namespace asg {
 
@@ -9,19 +10,23 @@ class Typing
 {
 public:
   Obj::Mgr& mMgr;
+  TypeCtx& mTypes;
 
-  Typing(Obj::Mgr& mgr)
+  Typing(Obj::Mgr& mgr, TypeCtx& types)
     : mMgr(mgr)
+    , mTypes(types)
   {
   }
 
   void operator()(TranslationUnit& tu);
 
 private:
+  Obj::Table<bool> mWalked;
+
   template<typename T, typename... Args>
-  T& make(Args... args)
+  T& make(Args&&... args)
   {
-    return mMgr.make<T>(args...);
+    return mMgr.make<T>(std::forward<Args>(args)...);
   }
 
   //============================================================================
@@ -90,13 +95,14 @@ private:
   /// 对于 \p lft = \p rht 的等式，转换 \p rht 的类型以适应 \p lft
   Expr* assigment_cast(Expr* lft, Expr* rht);
 
-  /// 由被赋值类型 \p to 倒推初始化表达式 \p init 的类型
-  Expr* infer_init(Expr* init, const Type& to);
+  /// 由被赋值类型 \p to 倒推初始化表达式 \p init 的类型，\p to 是长度未知的
+  /// 数组时，换成由初始化表达式确定长度的数组类型
+  Expr* infer_init(Expr* init, Type& to);
 
   /// 倒退列表初始化的类型，返回构造的初始化表达式和用到了第几个初始化元素
   std::pair<Expr*, std::size_t> infer_initlist(const std::vector<Expr*>& list,
                                                std::size_t begin,
-                                               const Type& to);
+                                               Type& to);
 };
 
 } // namespace asg
@@ -0,0 +1,129 @@
+#pragma once
+
+// 语义图的二进制交换格式，实验二的 Asg2Bin 写出、实验三的 Bin2Asg 读入，是
+// JSON 之外的另一种选择。
+// task/2/common/asgbin.hpp 与 task/3/asgbin.hpp 是同一份文件，修改时请同步。
+//
+// 文件由文件头和若干段组成，段都按 8 字节对齐，整数按写出时的本机字节序存放
+// （文件头中的 mByteOrder 用来检查），读入时可以直接在映射的内存上使用，不必
+// 逐项解析：
+//
+//   mStrings  Str[]      字符串表，声明的名字和字符串常量共用，0 号是空串
+//   mChars    char[]     字符串的内容，每个后面补一个 '\0'
+//   mTypes    TypeRec[]  类型表达式表，每种类型只出现一次，子类型排在前面
+//   mParams   TypeRef[]  函数类型的形参类型
+//   mNodes    NodeRec[]  语义图的节点
+//   mLists    uint32[]   节点的子节点列表
+//   mTop      uint32[]   翻译单元中的顶层声明
+//
+// 节点与类型表达式的引用都是下标加一，0 表示空。节点拥有的子节点总排在它后
+// 面，只有 DeclRefExpr::decl、BreakStmt::loop 这样的引用可以指向前面，读入
+// 时据此排除成环的输入。节点的种类直接存 Obj::Kind，改动 Obj::Kind 时必须同
+// 时增加 kVersion，下面的 static_assert 会提醒。
+
+#include "asg.hpp"
+#include <cstdint>
+
+namespace asgbin {
+
+inline constexpr char kMagic[8] = { 'S', 'Y', 's', 'U', 'A', 'S', 'G', '\n' };
+
+/// 格式的版本，格式有任何不兼容的改动时加一
+inline constexpr std::uint32_t kVersion = 1;
+
+/// 按本机字节序写入，读入时不相等说明字节序不同
+inline constexpr std::uint32_t kByteOrder = 0x01020304;
+
+struct Section
+{
+  std::uint64_t mOffset; // 距文件开头的字节数
+  std::uint64_t mCount;  // 元素个数
+};
+
+struct Header
+{
+  char mMagic[8];
+  std::uint32_t mVersion;
+  std::uint32_t mByteOrder;
+  Section mStrings, mChars, mTypes, mParams, mNodes, mLists, mTop;
+};
+
+struct Str
+{
+  std::uint32_t mOffset; // 在 mChars 中的位置
+  std::uint32_t mSize;
+};
+
+/// asg::Type，mTexp 是类型表达式的引用
+struct TypeRef
+{
+  std::uint8_t mSpec;
+  std::uint8_t mQual;
+  std::uint16_t mPad;
+  std::uint32_t mTexp;
+};
+
+struct TypeRec
+{
+  std::uint8_t mKind; // kPointerType、kArrayType、kFunctionType
+  std::uint8_t mQual; // 指针的限定
+  std::uint16_t mPad;
+  std::uint32_t mSub;
+  std::uint32_t mA; // 数组的长度，或函数形参在 mParams 中的起点
+  std::uint32_t mB; // 函数形参的个数
+};
+
+/**
+ * @brief 定长的节点记录，mA ~ mD 的含义由种类决定：
+ *
+ *   IntegerLiteral     mA、mB 是值的低、高 32 位
+ *   StringLiteral      mName 是值
+ *   DeclRefExpr        mA 是声明
+ *   ParenExpr 等       mA 是 sub（UnaryExpr、ImplicitCastExpr 相同）
+ *   BinaryExpr         mA、mB 是左右操作数
+ *   CallExpr           mA 是被调用者，mB、mC 是实参列表的起点和长度
+ *   InitListExpr       mB、mC 是列表
+ *   DeclStmt           mB、mC 是声明列表
+ *   ExprStmt           mA 是表达式
+ *   CompoundStmt       mB、mC 是语句列表
+ *   IfStmt             mA、mB、mC 是条件、then、else
+ *   WhileStmt、DoStmt  mA、mB 是条件、循环体
+ *   BreakStmt 等       mA 是所在的循环（ContinueStmt 相同）
+ *   ReturnStmt         mA 是返回值，mB 是所在的函数
+ *   VarDecl            mName、mType 是名字和类型，mA 是初始化式
+ *   FunctionDecl       mA 是函数体，mB、mC 是形参列表
+ */
+struct NodeRec
+{
+  std::uint8_t mKind; // asg::Obj::Kind
+  std::uint8_t mOp;   // 运算符或转换的种类
+  std::uint8_t mCate; // asg::Expr::Cate
+  std::uint8_t mPad;
+  std::uint32_t mName;
+  TypeRef mType;
+  std::uint32_t mA, mB, mC, mD;
+};
+
+static_assert(sizeof(Header) == 128);
+static_assert(sizeof(TypeRef) == 8);
+static_assert(sizeof(TypeRec) == 16);
+static_assert(sizeof(NodeRec) == 32);
+
+// 改动 Obj::Kind 后这里不再成立，请同时增加 kVersion
+static_assert(int(asg::Obj::Kind::kPointerType) == 2 &&
+              int(asg::Obj::Kind::kFunctionType) == 4 &&
+              int(asg::Obj::Kind::kIntegerLiteral) == 6 &&
+              int(asg::Obj::Kind::kImplicitCastExpr) == 15 &&
+              int(asg::Obj::Kind::kNullStmt) == 17 &&
+              int(asg::Obj::Kind::kReturnStmt) == 26 &&
+              int(asg::Obj::Kind::kVarDecl) == 28 &&
+              int(asg::Obj::Kind::kFunctionDecl) == 29);
+
+/// 段的起点按 8 字节对齐
+inline std::uint64_t
+align8(std::uint64_t n)
+{
+  return (n + 7) & ~std::uint64_t(7);
+}
+
+} // namespace asgbin
@@ -0,0 +1,226 @@
+#pragma once
+
+// 整数与字符常量的解码，词法分析时调用一次，之后各阶段直接使用数值。
+// task/1/common/literal.hpp 与 task/2/common/literal.hpp 是同一份文件，修改时
+// 请同步。
+
+#include <cstdint>
+#include <cstring>
+
+namespace literal {
+
+/// 整数常量的后缀，即 lex.l 中的 IS
+enum Suffix : std::uint8_t
+{
+  kNone = 0,
+  kUnsigned = 1, // u、U
+  kLong = 2,     // l、L
+  kLongLong = 4, // ll、LL
+};
+
+struct Integer
+{
+  std::uint64_t mValue{ 0 };
+  Suffix mSuffix{ kNone };
+};
+
+namespace detail {
+
+/// 十六进制数字的值，不是数字的字符为 0xff
+struct HexTable
+{
+  std::uint8_t mDigit[256];
+
+  constexpr HexTable()
+    : mDigit{}
+  {
+    for (int c = 0; c < 256; ++c)
+      mDigit[c] = 0xff;
+    for (int c = '0'; c <= '9'; ++c)
+      mDigit[c] = c - '0';
+    for (int c = 'a'; c <= 'f'; ++c)
+      mDigit[c] = mDigit[c - 'a' + 'A'] = c - 'a' + 10;
+  }
+};
+
+inline constexpr HexTable kHex;
+
+inline std::uint8_t
+hex(char c)
+{
+  return kHex.mDigit[std::uint8_t(c)];
+}
+
+/// 按小端序读入 8 个字节，第一个字符在最低字节
+inline std::uint64_t
+load8(const char* p)
+{
+  std::uint64_t v;
+  std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/// 8 个字节是否都是 '0' ~ '9'
+inline bool
+all_digits8(std::uint64_t v)
+{
+  return ((v & 0xf0f0f0f0f0f0f0f0) |
+          (((v + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) ==
+         0x3333333333333333;
+}
+
+/// 把 8 个十进制数字一次合并成数值，先两两合并，再四四合并，最后合并成一个
+inline std::uint64_t
+parse8(std::uint64_t v)
+{
+  v -= 0x3030303030303030;
+  v = (v * 10) + (v >> 8);
+  v = (((v & 0x000000ff000000ff) * (100 + (1000000ull << 32))) +
+       (((v >> 16) & 0x000000ff000000ff) * (1 + (10000ull << 32)))) >>
+      32;
+  return v & 0xffffffff;
+}
+
+/// 解析 [s + i, s + n) 开头的后缀，整个剩余部分都是合法后缀时返回 true
+inline bool
+suffix(const char* s, std::size_t i, std::size_t n, Suffix& out)
+{
+  unsigned r = kNone;
+  if (i < n && (s[i] | 0x20) == 'u') {
+    r |= kUnsigned;
+    ++i;
+  }
+  if (i < n && (s[i] | 0x20) == 'l') {
+    // ll 的两个字母大小写必须相同
+    bool ll = i + 1 < n && s[i + 1] == s[i];
+    r |= ll ? kLongLong : kLong;
+    i += ll ? 2 : 1;
+    if (!(r & kUnsigned) && i < n && (s[i] | 0x20) == 'u') {
+      r |= kUnsigned;
+      ++i;
+    }
+  }
+  out = Suffix(r);
+  return i == n;
+}
+
+/// 解码 s[i] 开始的一个（可能带转义的）字符，i 移到下一个字符
+inline std::uint32_t
+character(const char* s, std::size_t& i, std::size_t n)
+{
+  if (s[i] != '\\')
+    return std::uint8_t(s[i++]);
+
+  if (++i == n)
+    return '\\';
+  char c = s[i++];
+  switch (c) {
+    case 'a':
+      return '\a';
+    case 'b':
+      return '\b';
+    case 'f':
+      return '\f';
+    case 'n':
+      return '\n';
+    case 'r':
+      return '\r';
+    case 't':
+      return '\t';
+    case 'v':
+      return '\v';
+    case 'x': {
+      std::uint32_t v = 0;
+      for (std::uint8_t d; i < n && (d = hex(s[i])) < 16; ++i)
+        v = v << 4 | d;
+      return v;
+    }
+    default:
+      break;
+  }
+
+  // 至多三位的八进制转义
+  if (c >= '0' && c <= '7') {
+    std::uint32_t v = c - '0';
+    for (int k = 1; k < 3 && i < n && s[i] >= '0' && s[i] <= '7'; ++k, ++i)
+      v = v << 3 | (s[i] - '0');
+    return v;
+  }
+  return std::uint8_t(c); // \\ \' \" \? 以及不认识的转义
+}
+
+/// 字符常量 'c'、'ab'、L'c'，取值与 clang 相同
+inline bool
+char_constant(const char* s, std::size_t n, Integer& out)
+{
+  std::size_t i = 0;
+  bool wide = s[0] == 'L';
+  i += wide;
+  if (i == n || s[i] != '\'')
+    return false;
+
+  std::uint32_t v = 0;
+  int count = 0;
+  for (++i; i < n && s[i] != '\''; ++count) {
+    auto c = character(s, i, n);
+    v = wide ? c : v << 8 | (c & 0xff);
+  }
+  if (i + 1 != n || count == 0)
+    return false;
+
+  // 单个普通字符的类型是 char，按有符号扩展；其余情况都是 int
+  std::int32_t value = !wide && count == 1 ? std::int8_t(v) : std::int32_t(v);
+  out.mValue = std::uint64_t(std::int64_t(value));
+  out.mSuffix = kNone;
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief 解码 [s, s + n) 中的整数常量（十进制、八进制、十六进制，可带 IS 后缀）
+ * 或字符常量。文本是浮点常量或其它内容时返回 false，out 不变。
+ *
+ * 十进制数字每 8 个一组用 SWAR 合并，十六进制查表，循环中没有按字符分支。
+ * 超出 64 位的部分按模 2^64 截断。
+ */
+inline bool
+decode(const char* s, std::size_t n, Integer& out)
+{
+  if (n == 0)
+    return false;
+  if (s[0] == '\'' || s[0] == 'L')
+    return detail::char_constant(s, n, out);
+
+  std::uint64_t v = 0;
+  std::size_t i = 0;
+  if (s[0] == '0' && n > 1 && (s[1] | 0x20) == 'x') {
+    i = 2;
+    for (std::uint8_t d; i < n && (d = detail::hex(s[i])) < 16; ++i)
+      v = v << 4 | d;
+    if (i == 2)
+      return false;
+  } else if (s[0] == '0') {
+    for (i = 1; i < n && s[i] >= '0' && s[i] <= '7'; ++i)
+      v = v << 3 | (s[i] - '0');
+  } else {
+    for (; i + 8 <= n && detail::all_digits8(detail::load8(s + i)); i += 8)
+      v = v * 100000000 + detail::parse8(detail::load8(s + i));
+    for (; i < n && s[i] >= '0' && s[i] <= '9'; ++i)
+      v = v * 10 + (s[i] - '0');
+    if (i == 0)
+      return false;
+  }
+
+  Suffix sfx;
+  if (!detail::suffix(s, i, n, sfx))
+    return false; // 小数点、指数等说明这是浮点常量
+  out.mValue = v;
+  out.mSuffix = sfx;
+  return true;
+}
+
+} // namespace literal
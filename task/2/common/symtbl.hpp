@@ -0,0 +1,73 @@
+#pragma once
+
+#include "asg.hpp"
+#include <vector>
+
+namespace asg {
+
+/**
+ * @brief 带作用域的符号表，所有作用域共用一张以 Atom 编号为下标的表，表中总是
+ * 当前可见的声明。
+ *
+ * 绑定时把被遮蔽的旧声明记入撤销日志，离开作用域时按相反顺序恢复，即经典的
+ * 影子栈（shadow stack）做法。查找与嵌套深度无关，进入作用域只记一个位置，
+ * 不分配新表。Ast2Asg 和 Bison 的语义动作共用这个结构。
+ */
+class Symtbl
+{
+public:
+  /// 作用域守卫，构造时进入，析构时离开
+  class Scope
+  {
+  public:
+    Scope(Symtbl& symtbl)
+      : mSymtbl(symtbl)
+    {
+      mSymtbl.mMarks.push_back(mSymtbl.mLog.size());
+    }
+
+    ~Scope() { mSymtbl.leave(); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Symtbl& mSymtbl;
+  };
+
+  /// 在当前作用域中声明 name，同一作用域中重复声明时新定义取代旧定义
+  void bind(atom::Atom name, Decl* decl)
+  {
+    if (name.id() >= mTable.size())
+      mTable.resize(std::size_t(name.id()) + 1);
+    mLog.push_back({ name, mTable[name.id()] });
+    mTable[name.id()] = decl;
+  }
+
+  /// 当前可见的 name 的声明，未声明时返回空指针
+  Decl* resolve(atom::Atom name) const
+  {
+    return name.id() < mTable.size() ? mTable[name.id()] : nullptr;
+  }
+
+private:
+  struct Undo
+  {
+    atom::Atom mName;
+    Decl* mShadowed; // 被遮蔽的声明，没有则为空
+  };
+
+  std::vector<Decl*> mTable;
+  std::vector<Undo> mLog;
+  std::vector<std::size_t> mMarks; // 每层作用域开始时日志的长度
+
+  void leave()
+  {
+    ASSERT(!mMarks.empty());
+    for (auto mark = mMarks.back(); mLog.size() > mark; mLog.pop_back())
+      mTable[mLog.back().mName.id()] = mLog.back().mShadowed;
+    mMarks.pop_back();
+  }
+};
+
+} // namespace asg
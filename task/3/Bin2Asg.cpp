@@ -0,0 +1,423 @@
+#include "Bin2Asg.hpp"
+#include <cstring>
+
+#define self (*this)
+
+namespace asg {
+
+TranslationUnit
+Bin2Asg::operator()(llvm::StringRef data)
+{
+  mData = data;
+  read_header();
+  read_strings();
+  read_types();
+
+  // 先创建全部节点，向后的引用（比如 DeclRefExpr::decl）也能直接填写
+  mObjs.reserve(mNodes.mSize);
+  for (std::size_t i = 0; i < mNodes.mSize; ++i)
+    mObjs.push_back(make(mNodes[i]));
+  for (std::size_t i = 0; i < mNodes.mSize; ++i) {
+    mFilling = i + 1;
+    fill(mObjs[i], mNodes[i]);
+  }
+
+  TranslationUnit ret;
+  ret.reserve(mTop.mSize);
+  for (std::size_t i = 0; i < mTop.mSize; ++i) {
+    auto decl = ref<Decl>(mTop[i]);
+    if (decl == nullptr)
+      fail("null top-level declaration");
+    ret.push_back(decl);
+  }
+  return ret;
+}
+
+template<typename T>
+Bin2Asg::Span<T>
+Bin2Asg::section(const asgbin::Section& section)
+{
+  auto size = mData.size();
+  if (section.mOffset % alignof(T) != 0 || section.mOffset > size ||
+      section.mCount > (size - section.mOffset) / sizeof(T))
+    fail("section out of bounds");
+  return { reinterpret_cast<const T*>(mData.data() + section.mOffset),
+           std::size_t(section.mCount) };
+}
+
+void
+Bin2Asg::read_header()
+{
+  if (reinterpret_cast<std::uintptr_t>(mData.data()) % 8 != 0)
+    fail("misaligned buffer");
+  if (mData.size() < sizeof(asgbin::Header))
+    fail("truncated header");
+
+  auto& header = *reinterpret_cast<const asgbin::Header*>(mData.data());
+  if (std::memcmp(header.mMagic, asgbin::kMagic, sizeof(header.mMagic)) != 0)
+    fail("bad magic");
+  if (header.mVersion != asgbin::kVersion)
+    fail("unsupported version");
+  if (header.mByteOrder != asgbin::kByteOrder)
+    fail("byte order mismatch");
+
+  mStrings = section<asgbin::Str>(header.mStrings);
+  mChars = section<char>(header.mChars);
+  mTypeRecs = section<asgbin::TypeRec>(header.mTypes);
+  mParams = section<asgbin::TypeRef>(header.mParams);
+  mNodes = section<asgbin::NodeRec>(header.mNodes);
+  mLists = section<std::uint32_t>(header.mLists);
+  mTop = section<std::uint32_t>(header.mTop);
+}
+
+void
+Bin2Asg::read_strings()
+{
+  // 字符串表已经去重，每个只驻留一次
+  mAtoms.reserve(mStrings.mSize);
+  for (std::size_t i = 0; i < mStrings.mSize; ++i) {
+    auto& s = mStrings[i];
+    if (s.mOffset > mChars.mSize || s.mSize > mChars.mSize - s.mOffset)
+      fail("string out of bounds");
+    mAtoms.push_back(atom::intern({ mChars.mBegin + s.mOffset, s.mSize }));
+  }
+}
+
+void
+Bin2Asg::read_types()
+{
+  // 子类型总在前面，逐个向 TypeCtx 要即可
+  mTexps.reserve(mTypeRecs.mSize);
+  for (std::size_t i = 0; i < mTypeRecs.mSize; ++i) {
+    auto& rec = mTypeRecs[i];
+    if (rec.mSub > i)
+      fail("type refers forward");
+    auto sub = rec.mSub ? mTexps[rec.mSub - 1] : nullptr;
+
+    switch (Obj::Kind(rec.mKind)) {
+      case Obj::Kind::kPointerType:
+        if (rec.mQual > std::uint8_t(Type::Qual::kConst))
+          fail("bad qualifier");
+        mTexps.push_back(mTypes.pointer(sub, Type::Qual(rec.mQual)));
+        break;
+
+      case Obj::Kind::kArrayType:
+        mTexps.push_back(mTypes.array(sub, rec.mA));
+        break;
+
+      case Obj::Kind::kFunctionType: {
+        if (rec.mA > mParams.mSize || rec.mB > mParams.mSize - rec.mA)
+          fail("parameters out of bounds");
+        std::vector<Type> params;
+        params.reserve(rec.mB);
+        for (std::size_t j = rec.mA; j != rec.mA + rec.mB; ++j)
+          params.push_back(type(mParams[j], i));
+        mTexps.push_back(mTypes.function(sub, std::move(params)));
+        break;
+      }
+
+      default:
+        fail("bad type kind");
+    }
+  }
+}
+
+atom::Atom
+Bin2Asg::str(std::uint32_t i)
+{
+  if (i >= mAtoms.size())
+    fail("string index out of bounds");
+  return mAtoms[i];
+}
+
+Type
+Bin2Asg::type(const asgbin::TypeRef& ref, std::size_t limit)
+{
+  if (ref.mSpec > std::uint8_t(Type::Spec::kLongLong) ||
+      ref.mQual > std::uint8_t(Type::Qual::kConst))
+    fail("bad type");
+  if (ref.mTexp > limit)
+    fail("type index out of bounds");
+
+  Type ret;
+  ret.spec = Type::Spec(ref.mSpec);
+  ret.qual = Type::Qual(ref.mQual);
+  ret.texp = ref.mTexp ? mTexps[ref.mTexp - 1] : nullptr;
+  return ret;
+}
+
+template<typename T>
+T*
+Bin2Asg::ref(std::uint32_t i)
+{
+  if (i == 0)
+    return nullptr;
+  if (i > mObjs.size())
+    fail("node index out of bounds");
+  auto ret = dyn_cast<T>(mObjs[i - 1]);
+  if (ret == nullptr)
+    fail("node of wrong kind");
+  return ret;
+}
+
+template<typename T>
+T*
+Bin2Asg::need(std::uint32_t i)
+{
+  auto ret = ref<T>(i);
+  if (ret == nullptr)
+    fail("null reference");
+  return ret;
+}
+
+template<typename T>
+T*
+Bin2Asg::child(std::uint32_t i, bool nullable)
+{
+  // Asg2Bin 在填写父节点时才给子节点编号，子节点总在后面；只检查这一点就
+  // 能排除成环的输入，EmitIR 遍历时不会死循环
+  if (i == 0 && nullable)
+    return nullptr;
+  if (i <= mFilling)
+    fail(i == 0 ? "null child" : "child precedes parent");
+  return ref<T>(i);
+}
+
+Stmt*
+Bin2Asg::loop(std::uint32_t i)
+{
+  auto ret = need<Stmt>(i);
+  if (!dyn_cast<WhileStmt>(ret) && !dyn_cast<DoStmt>(ret))
+    fail("jump outside loop");
+  return ret;
+}
+
+template<typename T>
+void
+Bin2Asg::list(const asgbin::NodeRec& rec, std::vector<T*>& objs)
+{
+  if (rec.mB > mLists.mSize || rec.mC > mLists.mSize - rec.mB)
+    fail("list out of bounds");
+  objs.reserve(rec.mC);
+  for (std::size_t i = rec.mB; i != rec.mB + rec.mC; ++i)
+    objs.push_back(child<T>(mLists[i]));
+}
+
+Obj*
+Bin2Asg::make(const asgbin::NodeRec& rec)
+{
+  switch (Obj::Kind(rec.mKind)) {
+    case Obj::Kind::kIntegerLiteral:
+      return &mMgr.make<IntegerLiteral>();
+
+    case Obj::Kind::kStringLiteral:
+      return &mMgr.make<StringLiteral>();
+
+    case Obj::Kind::kDeclRefExpr:
+      return &mMgr.make<DeclRefExpr>();
+
+    case Obj::Kind::kParenExpr:
+      return &mMgr.make<ParenExpr>();
+
+    case Obj::Kind::kUnaryExpr:
+      return &mMgr.make<UnaryExpr>();
+
+    case Obj::Kind::kBinaryExpr:
+      return &mMgr.make<BinaryExpr>();
+
+    case Obj::Kind::kCallExpr:
+      return &mMgr.make<CallExpr>();
+
+    case Obj::Kind::kInitListExpr:
+      return &mMgr.make<InitListExpr>();
+
+    case Obj::Kind::kImplicitInitExpr:
+      return &mMgr.make<ImplicitInitExpr>();
+
+    case Obj::Kind::kImplicitCastExpr:
+      return &mMgr.make<ImplicitCastExpr>();
+
+    case Obj::Kind::kNullStmt:
+      return &mMgr.make<NullStmt>();
+
+    case Obj::Kind::kDeclStmt:
+      return &mMgr.make<DeclStmt>();
+
+    case Obj::Kind::kExprStmt:
+      return &mMgr.make<ExprStmt>();
+
+    case Obj::Kind::kCompoundStmt:
+      return &mMgr.make<CompoundStmt>();
+
+    case Obj::Kind::kIfStmt:
+      return &mMgr.make<IfStmt>();
+
+    case Obj::Kind::kWhileStmt:
+      return &mMgr.make<WhileStmt>();
+
+    case Obj::Kind::kDoStmt:
+      return &mMgr.make<DoStmt>();
+
+    case Obj::Kind::kBreakStmt:
+      return &mMgr.make<BreakStmt>();
+
+    case Obj::Kind::kContinueStmt:
+      return &mMgr.make<ContinueStmt>();
+
+    case Obj::Kind::kReturnStmt:
+      return &mMgr.make<ReturnStmt>();
+
+    case Obj::Kind::kVarDecl:
+      return &mMgr.make<VarDecl>();
+
+    case Obj::Kind::kFunctionDecl:
+      return &mMgr.make<FunctionDecl>();
+
+    default:
+      fail("bad node kind");
+  }
+}
+
+void
+Bin2Asg::fill(Obj* obj, const asgbin::NodeRec& rec)
+{
+  auto limit = mTexps.size();
+
+  if (auto p = dyn_cast<Expr>(obj)) {
+    if (rec.mCate > std::uint8_t(Expr::Cate::kLValue))
+      fail("bad value category");
+    p->type = type(rec.mType, limit);
+    p->cate = Expr::Cate(rec.mCate);
+  } else if (auto p = dyn_cast<Decl>(obj)) {
+    p->type = type(rec.mType, limit);
+    p->name = str(rec.mName);
+  }
+
+  switch (obj->tag) {
+    case Obj::Kind::kIntegerLiteral:
+      cast<IntegerLiteral>(obj)->val = std::uint64_t(rec.mB) << 32 | rec.mA;
+      break;
+
+    case Obj::Kind::kStringLiteral:
+      cast<StringLiteral>(obj)->val = str(rec.mName);
+      break;
+
+    case Obj::Kind::kDeclRefExpr:
+      cast<DeclRefExpr>(obj)->decl = need<Decl>(rec.mA);
+      break;
+
+    case Obj::Kind::kParenExpr:
+      cast<ParenExpr>(obj)->sub = child<Expr>(rec.mA);
+      break;
+
+    case Obj::Kind::kUnaryExpr: {
+      auto p = cast<UnaryExpr>(obj);
+      if (rec.mOp > UnaryExpr::kNot)
+        fail("bad unary operator");
+      p->op = UnaryExpr::Op(rec.mOp);
+      p->sub = child<Expr>(rec.mA);
+      break;
+    }
+
+    case Obj::Kind::kBinaryExpr: {
+      auto p = cast<BinaryExpr>(obj);
+      if (rec.mOp > BinaryExpr::kIndex)
+        fail("bad binary operator");
+      p->op = BinaryExpr::Op(rec.mOp);
+      p->lft = child<Expr>(rec.mA);
+      p->rht = child<Expr>(rec.mB);
+      break;
+    }
+
+    case Obj::Kind::kCallExpr: {
+      auto p = cast<CallExpr>(obj);
+      p->head = child<Expr>(rec.mA);
+      list(rec, p->args);
+      break;
+    }
+
+    case Obj::Kind::kInitListExpr:
+      list(rec, cast<InitListExpr>(obj)->list);
+      break;
+
+    case Obj::Kind::kImplicitInitExpr:
+      break;
+
+    case Obj::Kind::kImplicitCastExpr: {
+      auto p = cast<ImplicitCastExpr>(obj);
+      if (rec.mOp > ImplicitCastExpr::kNoOp)
+        fail("bad cast kind");
+      p->kind = decltype(p->kind)(rec.mOp);
+      p->sub = child<Expr>(rec.mA);
+      break;
+    }
+
+    case Obj::Kind::kNullStmt:
+      break;
+
+    case Obj::Kind::kDeclStmt:
+      list(rec, cast<DeclStmt>(obj)->decls);
+      break;
+
+    case Obj::Kind::kExprStmt:
+      cast<ExprStmt>(obj)->expr = child<Expr>(rec.mA);
+      break;
+
+    case Obj::Kind::kCompoundStmt:
+      list(rec, cast<CompoundStmt>(obj)->subs);
+      break;
+
+    case Obj::Kind::kIfStmt: {
+      auto p = cast<IfStmt>(obj);
+      p->cond = child<Expr>(rec.mA);
+      p->then = child<Stmt>(rec.mB);
+      p->else_ = child<Stmt>(rec.mC, true);
+      break;
+    }
+
+    case Obj::Kind::kWhileStmt: {
+      auto p = cast<WhileStmt>(obj);
+      p->cond = child<Expr>(rec.mA);
+      p->body = child<Stmt>(rec.mB);
+      break;
+    }
+
+    case Obj::Kind::kDoStmt: {
+      auto p = cast<DoStmt>(obj);
+      p->cond = child<Expr>(rec.mA);
+      p->body = child<Stmt>(rec.mB);
+      break;
+    }
+
+    case Obj::Kind::kBreakStmt:
+      cast<BreakStmt>(obj)->loop = loop(rec.mA);
+      break;
+
+    case Obj::Kind::kContinueStmt:
+      cast<ContinueStmt>(obj)->loop = loop(rec.mA);
+      break;
+
+    case Obj::Kind::kReturnStmt: {
+      auto p = cast<ReturnStmt>(obj);
+      p->expr = child<Expr>(rec.mA, true);
+      p->func = ref<FunctionDecl>(rec.mB);
+      break;
+    }
+
+    case Obj::Kind::kVarDecl:
+      cast<VarDecl>(obj)->init = child<Expr>(rec.mA, true);
+      break;
+
+    case Obj::Kind::kFunctionDecl: {
+      auto p = cast<FunctionDecl>(obj);
+      p->body = child<CompoundStmt>(rec.mA, true);
+      list(rec, p->params);
+      break;
+    }
+
+    default:
+      ABORT();
+  }
+}
+
+} // namespace asg
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "asg.hpp"
+#include "asgbin.hpp"
+#include "typectx.hpp"
+#include <llvm/ADT/StringRef.h>
+#include <vector>
+
+namespace asg {
+
+/**
+ * @brief 读入实验二 --format=bin 写出的二进制语义图。
+ *
+ * 各段直接在输入缓冲区（通常是映射的文件）上按结构体访问，不做任何解析：先检
+ * 查文件头和各段的边界，再按类型表构建类型，按节点表一次创建全部节点，最后
+ * 填写节点之间的引用。引用的下标越界、种类不对、必需的子节点为空，或者子节
+ * 点不排在父节点之后（拥有关系成环）时报错，不会中断。
+ */
+class Bin2Asg
+{
+public:
+  Obj::Mgr& mMgr;
+  TypeCtx& mTypes;
+
+  /// 输入不是合法的二进制语义图
+  struct Error
+  {
+    const char* mWhat;
+  };
+
+  Bin2Asg(Obj::Mgr& mgr, TypeCtx& types)
+    : mMgr(mgr)
+    , mTypes(types)
+  {
+  }
+
+  /// data 须按 8 字节对齐；出错时抛出 Error
+  TranslationUnit operator()(llvm::StringRef data);
+
+private:
+  llvm::StringRef mData;
+
+  /// 一段的元素，指向输入缓冲区
+  template<typename T>
+  struct Span
+  {
+    const T* mBegin{ nullptr };
+    std::size_t mSize{ 0 };
+
+    const T& operator[](std::size_t i) const { return mBegin[i]; }
+  };
+
+  Span<asgbin::Str> mStrings;
+  Span<char> mChars;
+  Span<asgbin::TypeRec> mTypeRecs;
+  Span<asgbin::TypeRef> mParams;
+  Span<asgbin::NodeRec> mNodes;
+  Span<std::uint32_t> mLists;
+  Span<std::uint32_t> mTop;
+
+  std::vector<atom::Atom> mAtoms;
+  std::vector<TypeExpr*> mTexps;
+  std::vector<Obj*> mObjs;
+  std::uint32_t mFilling{ 0 }; // 正在填写的节点的引用
+
+  [[noreturn]] static void fail(const char* what) { throw Error{ what }; }
+
+  template<typename T>
+  Span<T> section(const asgbin::Section& section);
+
+  void read_header();
+  void read_strings();
+  void read_types();
+
+  atom::Atom str(std::uint32_t i);
+  Type type(const asgbin::TypeRef& ref, std::size_t limit);
+
+  /// 引用的节点，0 为空指针，不是 T 时报错
+  template<typename T>
+  T* ref(std::uint32_t i);
+
+  /// 不能为空的引用
+  template<typename T>
+  T* need(std::uint32_t i);
+
+  /// 正在填写的节点拥有的子节点，必须排在它之后，nullable 为假时不能为空
+  template<typename T>
+  T* child(std::uint32_t i, bool nullable = false);
+
+  /// break、continue 所在的循环
+  Stmt* loop(std::uint32_t i);
+
+  /// rec 的 mB、mC 所指的子节点列表，元素都不能为空
+  template<typename T>
+  void list(const asgbin::NodeRec& rec, std::vector<T*>& objs);
+
+  Obj* make(const asgbin::NodeRec& rec);
+  void fill(Obj* obj, const asgbin::NodeRec& rec);
+};
+
+} // namespace asg
@@ -51,16 +51,16 @@ EmitIR::operator()(const Type& type)
   Type subt = type;
   subt.texp = type.texp->sub;
 
-  if (auto p = type.texp->dcst<ArrayType>()) {
+  if (auto p = dyn_cast<ArrayType>(type.texp)) {
     if (p->len == -1)
       return self(subt)->getPointerTo();
     return llvm::ArrayType::get(self(subt), p->len);
   }
 
-  if (auto p = type.texp->dcst<FunctionType>()) {
+  if (auto p = dyn_cast<FunctionType>(type.texp)) {
     std::vector<llvm::Type*> pty;
     for (auto&& i : p->params)
-      pty.push_back(self(i->type));
+      pty.push_back(self(i));
     return llvm::FunctionType::get(self(subt), std::move(pty), false);
   }
 
@@ -74,28 +74,20 @@ EmitIR::operator()(const Type& type)
 llvm::Value*
 EmitIR::operator()(Expr* obj)
 {
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<StringLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<DeclRefExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<UnaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<BinaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<CallExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ImplicitCastExpr>())
-    return self(p);
-
-  ABORT();
+  return visit(obj, [&](auto p) -> llvm::Value* {
+    using T = std::remove_pointer_t<decltype(p)>;
+    if constexpr (is_one_of<T,
+                            IntegerLiteral,
+                            StringLiteral,
+                            DeclRefExpr,
+                            UnaryExpr,
+                            BinaryExpr,
+                            CallExpr,
+                            ImplicitCastExpr>::value)
+      return self(p);
+    else
+      ABORT();
+  });
 }
 
 llvm::Constant*
@@ -107,21 +99,25 @@ EmitIR::operator()(IntegerLiteral* obj)
 llvm::Constant*
 EmitIR::operator()(StringLiteral* obj)
 {
-  auto p = obj->type.texp->dcst<ArrayType>();
+  auto p = dyn_cast<ArrayType>(obj->type.texp);
   if (!p)
     ABORT();
 
-  auto size = obj->val.size();
-  obj->val.resize(p->len - 1);
+  // 数组长度与字面量长度不同时截断或补零
+  llvm::StringRef str = obj->val.view();
+  std::string padded;
+  if (str.size() != p->len - 1) {
+    padded = str.str();
+    padded.resize(p->len - 1);
+    str = padded;
+  }
 
   auto val = new llvm::GlobalVariable(
     _mod,
     self(obj->type),
     true,
     llvm::GlobalVariable::PrivateLinkage,
-    llvm::ConstantDataArray::getString(_ctx, obj->val));
-
-  obj->val.resize(size);
+    llvm::ConstantDataArray::getString(_ctx, str));
 
   return val;
 }
@@ -131,7 +127,9 @@ EmitIR::operator()(DeclRefExpr* obj)
 {
   // 在LLVM IR层面，左值体现为返回指向值的指针
   // 在ImplicitCastExpr::kLValueToRValue中发射load指令从而变成右值
-  return std::any_cast<llvm::Value*>(obj->decl->any);
+  auto val = _values[obj->decl];
+  ASSERT(val);
+  return val;
 }
 
 llvm::Value*
@@ -318,7 +316,7 @@ EmitIR::trans_init(llvm::Value* val, Expr* obj)
 {
   auto& irb = *_curIrb;
 
-  if (auto p = obj->dcst<InitListExpr>()) {
+  if (auto p = dyn_cast<InitListExpr>(obj)) {
     irb.CreateStore(llvm::ConstantAggregateZero::get(val->getType()), val);
 
     for (int i = 0; i < p->list.size(); ++i) {
@@ -339,7 +337,7 @@ EmitIR::trans_init(llvm::Value* val, Expr* obj)
   }
 
   auto initVal = self(obj);
-  if (auto p = obj->dcst<StringLiteral>())
+  if (auto p = dyn_cast<StringLiteral>(obj))
     irb.CreateStore(irb.CreateLoad(val->getType(), initVal), val);
   else
     irb.CreateStore(initVal, val);
@@ -363,37 +361,11 @@ EmitIR::trans_bool(llvm::Value* cond)
 void
 EmitIR::operator()(Stmt* obj)
 {
-  if (auto p = obj->dcst<NullStmt>())
-    return;
-
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  ABORT();
+  visit(obj, [&](auto p) {
+    using T = std::remove_pointer_t<decltype(p)>;
+    if constexpr (!std::is_same_v<T, NullStmt>)
+      self(p);
+  });
 }
 
 void
@@ -402,12 +374,12 @@ EmitIR::operator()(DeclStmt* obj)
   auto& irb = *_curIrb;
 
   for (auto&& decl : obj->decls) {
-    auto p = decl->dcst<VarDecl>();
+    auto p = dyn_cast<VarDecl>(decl);
     if (!p)
       ABORT();
 
-    auto val = irb.CreateAlloca(self(p->type), nullptr, decl->name);
-    decl->any = std::make_any<llvm::Value*>(val);
+    auto val = irb.CreateAlloca(self(p->type), nullptr, decl->name.view());
+    _values[decl] = val;
 
     if (p->init != nullptr)
       trans_init(val, p->init);
@@ -465,10 +437,9 @@ EmitIR::operator()(WhileStmt* obj)
   auto loopBb = llvm::BasicBlock::Create(_ctx, "while_loop", _curFunc);
   auto exitBb = llvm::BasicBlock::Create(_ctx, "while_exit", _curFunc);
 
-  LoopAny loopAny;
+  auto& loopAny = _loops[obj];
   loopAny.continue_ = condBb;
   loopAny.break_ = exitBb;
-  obj->any = loopAny;
 
   _curIrb->CreateBr(condBb);
 
@@ -490,10 +461,9 @@ EmitIR::operator()(DoStmt* obj)
   auto condBb = llvm::BasicBlock::Create(_ctx, "do_cond", _curFunc);
   auto exitBb = llvm::BasicBlock::Create(_ctx, "do_exit", _curFunc);
 
-  LoopAny loopAny;
+  auto& loopAny = _loops[obj];
   loopAny.continue_ = condBb;
   loopAny.break_ = exitBb;
-  obj->any = loopAny;
 
   _curIrb->CreateBr(condBb);
 
@@ -511,7 +481,7 @@ EmitIR::operator()(DoStmt* obj)
 void
 EmitIR::operator()(BreakStmt* obj)
 {
-  auto& loopAny = std::any_cast<LoopAny&>(obj->loop->any);
+  auto& loopAny = _loops[obj->loop];
 
   _curIrb->CreateBr(loopAny.break_);
 
@@ -522,7 +492,7 @@ EmitIR::operator()(BreakStmt* obj)
 void
 EmitIR::operator()(ContinueStmt* obj)
 {
-  auto& loopAny = std::any_cast<LoopAny&>(obj->loop->any);
+  auto& loopAny = _loops[obj->loop];
 
   _curIrb->CreateBr(loopAny.continue_);
 
@@ -554,30 +524,30 @@ EmitIR::operator()(ReturnStmt* obj)
 void
 EmitIR::operator()(Decl* obj)
 {
-  if (auto p = obj->dcst<VarDecl>())
-    return self(p);
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
-
-  ABORT();
+  visit(obj, [&](auto p) { self(p); });
 }
 
 void
 EmitIR::operator()(VarDecl* obj)
 {
   auto ty = self(obj->type);
-  auto gvar = new llvm::GlobalVariable(
-    _mod, ty, false, llvm::GlobalVariable::ExternalLinkage, nullptr, obj->name);
+  auto gvar = new llvm::GlobalVariable(_mod,
+                                       ty,
+                                       false,
+                                       llvm::GlobalVariable::ExternalLinkage,
+                                       nullptr,
+                                       obj->name.view());
 
-  obj->any = std::make_any<llvm::Value*>(gvar);
+  _values[obj] = gvar;
 
   gvar->setInitializer(llvm::ConstantAggregateZero::get(ty));
   if (obj->init == nullptr)
     return;
 
-  _curFunc = llvm::Function::Create(
-    _ctorTy, llvm::GlobalVariable::PrivateLinkage, "ctor_" + obj->name, _mod);
+  _curFunc = llvm::Function::Create(_ctorTy,
+                                    llvm::GlobalVariable::PrivateLinkage,
+                                    "ctor_" + llvm::StringRef(obj->name.view()),
+                                    _mod);
   llvm::appendToGlobalCtors(_mod, _curFunc, 65535);
 
   auto entryBb = llvm::BasicBlock::Create(_ctx, "entry", _curFunc);
@@ -592,9 +562,9 @@ EmitIR::operator()(FunctionDecl* obj)
   // 创建函数
   auto fty = llvm::dyn_cast<llvm::FunctionType>(self(obj->type));
   auto func = llvm::Function::Create(
-    fty, llvm::GlobalVariable::ExternalLinkage, obj->name, _mod);
+    fty, llvm::GlobalVariable::ExternalLinkage, obj->name.view(), _mod);
 
-  obj->any = std::make_any<llvm::Value*>(func);
+  _values[obj] = func;
 
   if (obj->body == nullptr)
     return;
@@ -607,9 +577,9 @@ EmitIR::operator()(FunctionDecl* obj)
   for (auto&& param : obj->params) {
     auto val = entryIrb.CreateAlloca(argIter->getType());
     entryIrb.CreateStore(argIter, val);
-    param->any = std::make_any<llvm::Value*>(val);
+    _values[param] = val;
 
-    argIter->setName(param->name);
+    argIter->setName(param->name.view());
     ++argIter;
   }
 
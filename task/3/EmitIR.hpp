@@ -25,6 +25,9 @@ private:
 private:
   llvm::LLVMContext& _ctx;
 
+  Obj::Table<llvm::Value*> _values; // 声明对应的变量或函数
+  Obj::Table<LoopAny> _loops;       // 循环语句的跳转目标
+
   llvm::Type* _intTy;
   llvm::FunctionType* _ctorTy;
 
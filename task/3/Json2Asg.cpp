@@ -1,372 +1,610 @@
 #include "Json2Asg.hpp"
+#include "phash.hpp"
+#include <atomic>
+#include <exception>
+#include <thread>
 
 namespace asg {
 
 namespace {
 
-std::size_t
-jobj_id(const llvm::json::Object& jobj)
+/// read_attrs 关心的键
+enum class Attr
 {
-  auto id = jobj.getString("id");
-  ASSERT(id);
-  ASSERT(id->starts_with("0x"));
-  auto hexStr = id->substr(2).str();
-  return std::stoull(hexStr, nullptr, 16);
-}
+  kInner,
+  kKind,
+  kId,
+  kName,
+  kType,
+  kValueCategory,
+  kOpcode,
+  kCastKind,
+  kValue,
+  kReferencedDecl,
+  kIsImplicit,
+};
+
+constexpr std::string_view kAttrNames[] = {
+  "inner",         "kind",   "id",       "name",  "type",
+  "valueCategory", "opcode", "castKind", "value", "referencedDecl",
+  "isImplicit",
+};
+
+constexpr phash::Table kAttrs(kAttrNames);
+static_assert(kAttrs.ok());
+
+constexpr std::string_view kKindNames[] = {
+  "TranslationUnitDecl", "TypedefDecl",      "VarDecl",
+  "ParmVarDecl",         "FunctionDecl",     "CompoundStmt",
+  "DeclStmt",            "ExprStmt",         "ReturnStmt",
+  "BinaryOperator",      "ImplicitCastExpr", "DeclRefExpr",
+  "IntegerLiteral",
+};
+
+constexpr phash::Table kKinds(kKindNames);
+static_assert(kKinds.ok());
+
+constexpr std::string_view kOpcodeNames[] = {
+  "*", "/", "%", "+", "-", ">", "<", ">=", "<=", "==", "!=", "&&", "||", "=",
+  ",",
+};
+
+constexpr BinaryExpr::Op kOpcodes[] = {
+  BinaryExpr::kMul, BinaryExpr::kDiv, BinaryExpr::kMod,    BinaryExpr::kAdd,
+  BinaryExpr::kSub, BinaryExpr::kGt,  BinaryExpr::kLt,     BinaryExpr::kGe,
+  BinaryExpr::kLe,  BinaryExpr::kEq,  BinaryExpr::kNe,     BinaryExpr::kAnd,
+  BinaryExpr::kOr,  BinaryExpr::kAssign, BinaryExpr::kComma,
+};
+
+constexpr phash::Table kOpcodeTable(kOpcodeNames);
+static_assert(kOpcodeTable.ok());
+static_assert(std::size(kOpcodeNames) == std::size(kOpcodes));
+
+constexpr std::string_view kCastKindNames[] = {
+  "LValueToRValue",         "IntegralCast", "ArrayToPointerDecay",
+  "FunctionToPointerDecay", "NoOp",
+};
+
+constexpr decltype(ImplicitCastExpr::kind) kCastKinds[] = {
+  ImplicitCastExpr::kLValueToRValue,
+  ImplicitCastExpr::kIntegralCast,
+  ImplicitCastExpr::kArrayToPointerDecay,
+  ImplicitCastExpr::kFunctionToPointerDecay,
+  ImplicitCastExpr::kNoOp,
+};
+
+constexpr phash::Table kCastKindTable(kCastKindNames);
+static_assert(kCastKindTable.ok());
+static_assert(std::size(kCastKindNames) == std::size(kCastKinds));
 
 } // namespace
 
+std::uint64_t
+Json2Asg::parse_id(llvm::StringRef id)
+{
+  ASSERT(id.size() > 2 && id.size() <= 18 && id[0] == '0' && id[1] == 'x');
+  std::uint64_t ret = 0;
+  for (auto c : id.drop_front(2)) {
+    unsigned d = c >= '0' && c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10u;
+    ASSERT(d < 16);
+    ret = ret << 4 | d;
+  }
+  return ret;
+}
+
 TranslationUnit
-Json2Asg::operator()(const llvm::json::Value& jval)
+Json2Asg::operator()(llvm::StringRef text, unsigned jobs)
 {
-  auto jobj = jval.getAsObject();
-  ASSERT(jobj);
-  ASSERT(jobj->getString("kind") == "TranslationUnitDecl");
+  mReader = std::make_unique<jsax::Reader>(text);
 
-  auto inner = jobj->getArray("inner");
-  ASSERT(inner);
+  std::vector<Body> bodies;
+  if (jobs > 1)
+    mBodies = &bodies;
 
   TranslationUnit ret;
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = decl(*jobj))
-      ret.push_back(p);
+  child([&](Node& node) {
+    ASSERT(node.mKind == NodeKind::kTranslationUnitDecl);
+    ASSERT(node.mInner != Node::kNoInner);
+    inner(node, [&](Node& node) {
+      if (auto p = decl(node))
+        ret.push_back(p);
+    });
+  });
+  mReader->end();
+
+  mReader.reset();
+  mBodies = nullptr;
+
+  if (!bodies.empty())
+    convert_bodies(text, bodies, jobs);
+  return ret;
+}
+
+void
+Json2Asg::convert_bodies(llvm::StringRef text,
+                         std::vector<Body>& bodies,
+                         unsigned jobs)
+{
+  jobs = std::min<std::size_t>(jobs, bodies.size());
+  std::unique_ptr<Obj::Mgr[]> mgrs(new Obj::Mgr[jobs]);
+
+  // 函数体大小不一，各线程做完一个再领下一个
+  std::atomic<std::size_t> next{ 0 };
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  auto work = [&](Obj::Mgr& mgr) {
+    Json2Asg worker(mgr, *this);
+    worker.mReader = std::make_unique<jsax::Reader>(text);
+    try {
+      for (std::size_t i; (i = next++) < bodies.size();) {
+        Node node;
+        node.mKind = NodeKind::kFunctionDecl;
+        node.mInner = bodies[i].mInner;
+        worker.function_body(bodies[i].mFunc, node);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error)
+        error = std::current_exception();
+      next = bodies.size(); // 其余线程不再领取
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; ++i)
+    threads.emplace_back(work, std::ref(mgrs[i]));
+  work(mgrs[0]);
+  for (auto&& t : threads)
+    t.join();
+
+  // 出错时也先并入，已经建好的节点与 mMgr 一起释放
+  for (unsigned i = 0; i < jobs; ++i)
+    mMgr.adopt(mgrs[i]);
+  if (error)
+    std::rethrow_exception(error);
+}
+
+Decl*
+Json2Asg::find_decl(llvm::StringRef id) const
+{
+  auto key = parse_id(id);
+  auto ret = mIdMap.find(key);
+  if (ret == nullptr && mParent != nullptr)
+    ret = mParent->mIdMap.find(key);
+  return dyn_cast<Decl>(ret);
+}
+
+//==============================================================================
+// 读取对象
+//==============================================================================
+
+void
+Json2Asg::read_node(Node& node)
+{
+  mReader->begin_object(); // 不是对象时抛出 jsax::Error
+  read_attrs(node);
+}
+
+void
+Json2Asg::read_attrs(Node& node)
+{
+  auto& rd = *mReader;
+  llvm::StringRef key;
+  while (rd.next_key(key)) {
+    switch (Attr(kAttrs.find(key))) {
+      case Attr::kInner:
+        if (node.mKind != NodeKind::kNone && node.mInner == Node::kNoInner) {
+          node.mInner = Node::kAtInner;
+          return;
+        }
+        // kind 还不知道，先记下位置
+        node.mInner = rd.tell();
+        rd.skip();
+        break;
+
+      case Attr::kKind: {
+        auto i = kKinds.find(rd.string());
+        node.mKind = i < 0 ? NodeKind::kOther : NodeKind(i);
+        break;
+      }
+
+      case Attr::kId:
+        node.mId = rd.string();
+        break;
+
+      case Attr::kName:
+        node.mName = rd.string();
+        break;
+
+      case Attr::kType:
+        read_type(node);
+        break;
+
+      case Attr::kValueCategory:
+        node.mValueCategory = rd.string();
+        break;
+
+      case Attr::kOpcode:
+        node.mOpcode = rd.string();
+        break;
+
+      case Attr::kCastKind:
+        node.mCastKind = rd.string();
+        break;
+
+      case Attr::kValue:
+        node.mValue = rd.string();
+        break;
+
+      case Attr::kReferencedDecl:
+        read_ref(node);
+        break;
+
+      case Attr::kIsImplicit:
+        node.mImplicit = rd.boolean();
+        break;
+
+      default:
+        rd.skip();
+    }
   }
+}
 
-  return ret;
+void
+Json2Asg::read_type(Node& node)
+{
+  auto& rd = *mReader;
+  rd.begin_object();
+  llvm::StringRef key;
+  while (rd.next_key(key)) {
+    if (key == "qualType")
+      node.mQualType = rd.string();
+    else
+      rd.skip();
+  }
+}
+
+void
+Json2Asg::read_ref(Node& node)
+{
+  auto& rd = *mReader;
+  rd.begin_object();
+  llvm::StringRef key;
+  while (rd.next_key(key)) {
+    if (key == "id")
+      node.mRefId = rd.string();
+    else
+      rd.skip();
+  }
+}
+
+template<typename F>
+void
+Json2Asg::inner(Node& node, F&& f)
+{
+  auto& rd = *mReader;
+  auto elems = [&] {
+    rd.begin_array();
+    while (rd.next_elem())
+      child(f);
+  };
+
+  if (node.mInner == Node::kAtInner) {
+    node.mInner = Node::kNoInner;
+    elems();
+    read_attrs(node);
+  } else if (node.mInner != Node::kNoInner) {
+    auto back = rd.tell();
+    rd.seek(std::exchange(node.mInner, Node::kNoInner));
+    elems();
+    rd.seek(back);
+  }
+}
+
+void
+Json2Asg::finish(Node& node)
+{
+  if (node.mInner == Node::kAtInner) {
+    node.mInner = Node::kNoInner;
+    mReader->skip();
+    read_attrs(node);
+  }
 }
 
+template<typename F>
+void
+Json2Asg::child(F&& f)
+{
+  Node node;
+  read_node(node);
+  f(node);
+  finish(node);
+}
+
+//==============================================================================
+// 节点
+//==============================================================================
+
 Type
-Json2Asg::gety(const llvm::json::Object& jobj)
+Json2Asg::gety(const Node& node)
 {
-  auto a = jobj.getObject("type");
-  ASSERT(a);
-  auto b = a->getString("qualType");
-  ASSERT(b);
-  auto texpStr = b->str();
+  ASSERT(!node.mQualType.empty());
 
-  auto iter = mTyMap.find(texpStr);
+  auto iter = mTyMap.find(node.mQualType);
   if (iter != mTyMap.end())
     return iter->second;
 
+  // 第二阶段中各线程共用 mTypes，只在这里新建类型，缓存未命中时才加锁
+  std::unique_lock<std::mutex> lock;
+  if (mParent != nullptr)
+    lock = std::unique_lock<std::mutex>(mParent->mTypesMutex);
+
+  // parse_type 需要以 '\0' 结尾的文本
+  auto texpStr = atom::intern(node.mQualType);
   Type ty;
   auto s = parse_type(texpStr.c_str(), ty);
   ASSERT(s && *s == '\0');
-  mTyMap.emplace(texpStr, ty);
+  mTyMap.emplace(texpStr.view(), ty);
   return ty;
 }
 
 Decl*
-Json2Asg::decl(const llvm::json::Object& jobj)
+Json2Asg::decl(Node& node)
 {
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
+  switch (node.mKind) {
+    case NodeKind::kTypedefDecl:
+      return nullptr;
 
-  if (kind == "TypedefDecl")
-    return nullptr;
+    case NodeKind::kVarDecl:
+      return var_decl(node);
 
-  if (kind == "VarDecl")
-    return var_decl(jobj);
+    case NodeKind::kFunctionDecl:
+      return function_decl(node);
+
+    default:
+      break;
+  }
 
-  if (kind == "FunctionDecl")
-    return function_decl(jobj);
+  // 其余的隐式声明（如 __NSConstantString_tag）用不到
+  if (node.mImplicit)
+    return nullptr;
 
   ABORT(); // 未知的节点种类
 }
 
 VarDecl*
-Json2Asg::var_decl(const llvm::json::Object& jobj)
-{
-  auto obj = make<VarDecl>(jobj_id(jobj));
-  obj->name = jobj.getString("name").value();
-  obj->type = gety(jobj);
-
-  auto inner = jobj.getArray("inner");
-  if (inner) {
-    for (auto&& jval : *inner) {
-      auto jobj = jval.getAsObject();
-      ASSERT(jobj);
-      if (auto p = expr(*jobj))
-        obj->init = p;
-    }
-  } else
-    obj->init = nullptr;
+Json2Asg::var_decl(Node& node)
+{
+  auto obj = make<VarDecl>(node.mId);
+  obj->name = atom::intern(node.mName);
+  obj->type = gety(node);
+
+  obj->init = nullptr;
+  inner(node, [&](Node& node) {
+    if (auto p = expr(node))
+      obj->init = p;
+  });
 
   return obj;
 }
 
 FunctionDecl*
-Json2Asg::function_decl(const llvm::json::Object& jobj)
+Json2Asg::function_decl(Node& node)
 {
-  auto obj = make<FunctionDecl>(jobj_id(jobj));
-  obj->name = jobj.getString("name").value();
-  obj->type = gety(jobj);
+  auto obj = make<FunctionDecl>(node.mId);
+  obj->name = atom::intern(node.mName);
+  obj->type = gety(node);
+
+  ASSERT(node.mInner != Node::kNoInner);
+  if (mBodies != nullptr) {
+    // 第一阶段只记下 inner 的位置，由 finish() 跳过
+    mBodies->push_back({ obj, node.mInner == Node::kAtInner ? mReader->tell()
+                                                             : node.mInner });
+    return obj;
+  }
+
+  function_body(obj, node);
+  return obj;
+}
 
-  auto inner = jobj.getArray("inner");
-  // if(!inner)
-  //   return nullptr;
-  ASSERT(inner);
+void
+Json2Asg::function_body(FunctionDecl* obj, Node& node)
+{
   cur_func = obj;
 
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
+  inner(node, [&](Node& node) {
+    switch (node.mKind) {
+      case NodeKind::kParmVarDecl:
+        obj->params.push_back(var_decl(node));
+        break;
 
-    auto kind = jobj->getString("kind");
-    if (kind == "ParmVarDecl") {
-      obj->params.push_back(var_decl(*jobj));
-      continue;
-    }
+      case NodeKind::kCompoundStmt:
+        ASSERT(obj->body == nullptr);
+        obj->body = compound_stmt(node);
+        break;
 
-    if (kind == "CompoundStmt") {
-      ASSERT(obj->body == nullptr);
-      obj->body = compound_stmt(*jobj);
-      continue;
+      default:
+        ABORT();
     }
-
-    ABORT();
-  }
-
-  return obj;
+  });
 }
 
 Expr*
-Json2Asg::expr(const llvm::json::Object& jobj)
+Json2Asg::expr(Node& node)
 {
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
+  switch (node.mKind) {
+    case NodeKind::kBinaryOperator:
+      return binary_expr(node);
 
-  if (kind == "BinaryOperator")
-    return binary_expr(jobj);
+    case NodeKind::kImplicitCastExpr:
+      return implicit_cast_expr(node);
 
-  if (kind == "ImplicitCastExpr")
-    return implicit_cast_expr(jobj);
+    case NodeKind::kDeclRefExpr:
+      return declref_expr(node);
 
-  if (kind == "DeclRefExpr")
-    return declref_expr(jobj);
+    case NodeKind::kIntegerLiteral:
+      return integer_literal(node);
 
-  if (kind == "IntegerLiteral")
-    return integer_literal(jobj);
+    case NodeKind::kNone:
+      ABORT(); // 没有 kind
 
-  return nullptr;
+    default:
+      return nullptr;
+  }
 }
 
 BinaryExpr*
-Json2Asg::binary_expr(const llvm::json::Object& jobj)
-{
-  auto obj = make<BinaryExpr>(jobj_id(jobj));
-  obj->type = gety(jobj);
-  obj->cate = getvc(jobj);
-
-  auto a = jobj.getString("opcode");
-  ASSERT(a);
-  auto op = a->str();
-  if (op == "*")
-    obj->op = BinaryExpr::Op::kMul;
-  else if (op == "/")
-    obj->op = BinaryExpr::Op::kDiv;
-  else if (op == "%")
-    obj->op = BinaryExpr::Op::kMod;
-  else if (op == "+")
-    obj->op = BinaryExpr::Op::kAdd;
-  else if (op == "-")
-    obj->op = BinaryExpr::Op::kSub;
-  else if (op == ">")
-    obj->op = BinaryExpr::Op::kGt;
-  else if (op == "<")
-    obj->op = BinaryExpr::Op::kLt;
-  else if (op == ">=")
-    obj->op = BinaryExpr::Op::kGe;
-  else if (op == "<=")
-    obj->op = BinaryExpr::Op::kLe;
-  else if (op == "==")
-    obj->op = BinaryExpr::Op::kEq;
-  else if (op == "!=")
-    obj->op = BinaryExpr::Op::kNe;
-  else if (op == "&&")
-    obj->op = BinaryExpr::Op::kAnd;
-  else if (op == "||")
-    obj->op = BinaryExpr::Op::kOr;
-  else if (op == "=")
-    obj->op = BinaryExpr::Op::kAssign;
-  else if (op == ",")
-    obj->op = BinaryExpr::Op::kComma;
-  else
-    obj->op = BinaryExpr::Op::kINVALID;
+Json2Asg::binary_expr(Node& node)
+{
+  auto obj = make<BinaryExpr>(node.mId);
+  obj->type = gety(node);
+  obj->cate = getvc(node);
+
+  ASSERT(!node.mOpcode.empty());
+  auto op = kOpcodeTable.find(node.mOpcode);
+  obj->op = op < 0 ? BinaryExpr::Op::kINVALID : kOpcodes[op];
   // TODO: BinaryExpr::Op::kIndex
 
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
+  ASSERT(node.mInner != Node::kNoInner);
 
   int index = 0;
-  for (auto&& jval : *inner) {
-    if (auto p = jval.getAsObject()) {
-      if (index == 0)
-        obj->lft = expr(*p);
-      else
-        obj->rht = expr(*p);
-      index++;
-    }
-  }
+  inner(node, [&](Node& node) {
+    if (index == 0)
+      obj->lft = expr(node);
+    else
+      obj->rht = expr(node);
+    index++;
+  });
   return obj;
 }
 
 Expr::Cate
-Json2Asg::getvc(const llvm::json::Object& jobj)
+Json2Asg::getvc(const Node& node)
 {
-  auto p = jobj.getString("valueCategory");
-  ASSERT(p);
-  auto valueCategory = p->str();
+  auto& valueCategory = node.mValueCategory;
+  ASSERT(!valueCategory.empty());
   if (valueCategory == "lvalue")
     return Expr::Cate::kLValue;
   return Expr::Cate::kRValue;
 }
 
 ImplicitCastExpr*
-Json2Asg::implicit_cast_expr(const llvm::json::Object& jobj)
-{
-  auto obj = make<ImplicitCastExpr>(jobj_id(jobj));
-  obj->type = gety(jobj);
-  obj->cate = getvc(jobj);
-
-  auto a = jobj.getString("castKind");
-  ASSERT(a);
-  auto castkind = a->str();
-  if (castkind == "LValueToRValue")
-    obj->kind = ImplicitCastExpr::kLValueToRValue;
-  else if (castkind == "IntegralCast")
-    obj->kind = ImplicitCastExpr::kIntegralCast;
-  else if (castkind == "ArrayToPointerDecay")
-    obj->kind = ImplicitCastExpr::kArrayToPointerDecay;
-  else if (castkind == "FunctionToPointerDecay")
-    obj->kind = ImplicitCastExpr::kFunctionToPointerDecay;
-  else if (castkind == "NoOp")
-    obj->kind = ImplicitCastExpr::kNoOp;
-  else
-    obj->kind = ImplicitCastExpr::kINVALID;
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = expr(*jobj))
+Json2Asg::implicit_cast_expr(Node& node)
+{
+  auto obj = make<ImplicitCastExpr>(node.mId);
+  obj->type = gety(node);
+  obj->cate = getvc(node);
+
+  ASSERT(!node.mCastKind.empty());
+  auto kind = kCastKindTable.find(node.mCastKind);
+  obj->kind = kind < 0 ? ImplicitCastExpr::kINVALID : kCastKinds[kind];
+
+  ASSERT(node.mInner != Node::kNoInner);
+  inner(node, [&](Node& node) {
+    if (auto p = expr(node))
       obj->sub = p;
-  }
+  });
   return obj;
 }
 
 DeclRefExpr*
-Json2Asg::declref_expr(const llvm::json::Object& jobj)
+Json2Asg::declref_expr(Node& node)
 {
-  auto obj = make<DeclRefExpr>(jobj_id(jobj));
-  obj->type = gety(jobj);
-  obj->cate = getvc(jobj);
+  auto obj = make<DeclRefExpr>(node.mId);
+  obj->type = gety(node);
+  obj->cate = getvc(node);
 
-  auto a = jobj.getObject("referencedDecl");
-  ASSERT(a);
-  auto id = jobj_id(*a);
-  obj->decl = dynamic_cast<Decl*>(mIdMap[id]);
+  ASSERT(!node.mRefId.empty());
+  obj->decl = find_decl(node.mRefId);
 
   return obj;
 }
 
 IntegerLiteral*
-Json2Asg::integer_literal(const llvm::json::Object& jobj)
+Json2Asg::integer_literal(Node& node)
 {
-  auto obj = make<IntegerLiteral>(jobj_id(jobj));
-  obj->type = gety(jobj);
-  obj->cate = getvc(jobj);
+  auto obj = make<IntegerLiteral>(node.mId);
+  obj->type = gety(node);
+  obj->cate = getvc(node);
 
-  auto a = jobj.getString("value");
-  ASSERT(a);
-  auto val = a->str();
-  obj->val = strtoll(val.c_str(), NULL, 10);
-  ASSERT(errno != ERANGE);
+  ASSERT(!node.mValue.empty());
+  ASSERT(!node.mValue.getAsInteger(10, obj->val));
   return obj;
 }
 
 ExprStmt*
-Json2Asg::expr_stmt(const llvm::json::Object& jobj)
+Json2Asg::expr_stmt(Node& node)
 {
-  auto obj = make<ExprStmt>(jobj_id(jobj));
-  obj->expr = expr(jobj);
+  auto obj = make<ExprStmt>(node.mId);
+  obj->expr = expr(node);
   return obj;
 }
 
 Stmt*
-Json2Asg::stmt(const llvm::json::Object& jobj)
+Json2Asg::stmt(Node& node)
 {
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
+  switch (node.mKind) {
+    case NodeKind::kDeclStmt:
+      return decl_stmt(node);
 
-  if (kind == "DeclStmt")
-    return decl_stmt(jobj);
+    case NodeKind::kExprStmt:
+      return nullptr;
 
-  if (kind == "ExprStmt")
-    return nullptr;
+    case NodeKind::kReturnStmt:
+      return return_stmt(node);
 
-  if (kind == "ReturnStmt")
-    return return_stmt(jobj);
+    case NodeKind::kBinaryOperator:
+      return expr_stmt(node);
 
-  if (kind == "BinaryOperator")
-    return expr_stmt(jobj);
+    case NodeKind::kNone:
+      ABORT(); // 没有 kind
 
-  return nullptr;
+    default:
+      return nullptr;
+  }
 }
 
 CompoundStmt*
-Json2Asg::compound_stmt(const llvm::json::Object& jobj)
+Json2Asg::compound_stmt(Node& node)
 {
-  auto obj = make<CompoundStmt>(jobj_id(jobj));
-  auto inner = jobj.getArray("inner");
-  if (!inner)
+  auto obj = make<CompoundStmt>(node.mId);
+  if (node.mInner == Node::kNoInner)
     return nullptr;
 
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = stmt(*jobj))
+  inner(node, [&](Node& node) {
+    if (auto p = stmt(node))
       obj->subs.emplace_back(p);
-  }
+  });
 
   return obj;
 }
 
 DeclStmt*
-Json2Asg::decl_stmt(const llvm::json::Object& jobj)
+Json2Asg::decl_stmt(Node& node)
 {
-  auto obj = make<DeclStmt>(jobj_id(jobj));
-  auto inner = jobj.getArray("inner");
-  if (!inner)
+  auto obj = make<DeclStmt>(node.mId);
+  if (node.mInner == Node::kNoInner)
     return nullptr;
 
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = decl(*jobj))
+  inner(node, [&](Node& node) {
+    if (auto p = decl(node))
       obj->decls.emplace_back(p);
-  }
+  });
 
   return obj;
 }
 
 ReturnStmt*
-Json2Asg::return_stmt(const llvm::json::Object& jobj)
-{
-  auto obj = make<ReturnStmt>(jobj_id(jobj));
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-  // if(!inner)
-  //   return nullptr;
-
-  for (auto&& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = expr(*jobj))
+Json2Asg::return_stmt(Node& node)
+{
+  auto obj = make<ReturnStmt>(node.mId);
+  ASSERT(node.mInner != Node::kNoInner);
+
+  inner(node, [&](Node& node) {
+    if (auto p = expr(node))
       obj->expr = p;
-  }
+  });
   obj->func = cur_func;
 
   return obj;
@@ -479,18 +717,6 @@ parse_oct(const char* s, std::uint32_t& v)
   return s;
 }
 
-/// 把 \p texp 的里面翻出来，因为 C 的类型表达式与表达式内外顺序是相反的。
-TypeExpr*
-turn_texp(TypeExpr* texp)
-{
-  if (texp->sub == nullptr)
-    return texp;
-  auto innerMost = turn_texp(texp->sub);
-  innerMost->sub = texp;
-  texp->sub = nullptr;
-  return innerMost;
-}
-
 } // namespace
 
 const char*
@@ -507,21 +733,43 @@ Json2Asg::parse_type(const char* s, Type& v)
     s = p;
   }
 
-  s = parse_texp(skip_spaces(s), v.texp);
-  if (v.texp)
-    v.texp = turn_texp(v.texp); // 将类型表达式内外翻转
+  Layers layers;
+  s = parse_texp(skip_spaces(s), layers);
+  if (!s)
+    return nullptr;
+
+  // C 的类型表达式与表达式内外顺序相反，从最内层开始构建
+  v.texp = nullptr;
+  for (auto i = layers.rbegin(); i != layers.rend(); ++i) {
+    switch (i->mKind) {
+      case Obj::Kind::kPointerType:
+        v.texp = mTypes.pointer(v.texp);
+        break;
+
+      case Obj::Kind::kArrayType:
+        v.texp = mTypes.array(v.texp, i->mLen);
+        break;
+
+      case Obj::Kind::kFunctionType:
+        v.texp = mTypes.function(v.texp, std::move(i->mParams));
+        break;
+
+      default:
+        ABORT();
+    }
+  }
 
   return s;
 }
 
 const char*
-Json2Asg::parse_texp(const char* s, TypeExpr*& v)
+Json2Asg::parse_texp(const char* s, Layers& v)
 {
   return parse_texp_2(s, v);
 }
 
 const char*
-Json2Asg::parse_texp_0(const char* s, TypeExpr*& v)
+Json2Asg::parse_texp_0(const char* s, Layers& v)
 {
 RULE_1:
   if (auto p = match(s, "[")) {
@@ -532,24 +780,20 @@ RULE_1:
     p = match(skip_spaces(p), "]");
     if (!p)
       goto RULE_2;
-    auto& arrTy = mMgr.make<ArrayType>();
-    arrTy.len = len;
-    v = &arrTy;
+    v = { Layer{ Obj::Kind::kArrayType, len } };
     return p;
   }
 
 RULE_2:
   if (auto p = match(s, "(")) {
-    std::vector<Decl*> params;
+    std::vector<Type> params;
     p = parse_args(skip_spaces(p), params);
     if (!p)
       goto RULE_3;
     p = match(skip_spaces(p), ")");
     if (!p)
       goto RULE_3;
-    auto& funTy = mMgr.make<FunctionType>();
-    funTy.params = std::move(params);
-    v = &funTy;
+    v = { Layer{ Obj::Kind::kFunctionType, 0, std::move(params) } };
     return p;
   }
 
@@ -565,36 +809,38 @@ RULE_3:
   }
 
 EMPTY:
-  v = nullptr;
+  v.clear();
   return s;
 }
 
 const char*
-Json2Asg::parse_texp_1(const char* s, TypeExpr*& v)
+Json2Asg::parse_texp_1(const char* s, Layers& v)
 {
-  TypeExpr* texp;
+  Layers texp;
   auto p = parse_texp_0(s, texp);
   if (!p)
     return nullptr;
   if (s != p) {
     while (true) {
       s = p;
-      TypeExpr* sup;
+      Layers sup;
       p = parse_texp_0(skip_spaces(p), sup);
       if (!p)
         return nullptr;
       if (s == p)
         break;
-      sup->sub = texp;
-      texp = sup;
+      // 后缀的 [] 和 () 在 texp 的里层
+      texp.insert(texp.end(),
+                  std::make_move_iterator(sup.begin()),
+                  std::make_move_iterator(sup.end()));
     }
   }
-  v = texp;
+  v = std::move(texp);
   return s;
 }
 
 const char*
-Json2Asg::parse_texp_2(const char* s, TypeExpr*& v)
+Json2Asg::parse_texp_2(const char* s, Layers& v)
 {
 RULE_1:
   if (auto p = parse_texp_1(s, v))
@@ -602,12 +848,12 @@ RULE_1:
 
 RULE_2:
   if (auto p = match(s, "*")) {
-    TypeExpr* texp;
+    Layers texp;
     p = parse_texp_2(skip_spaces(p), texp);
     if (!p)
       goto EMPTY;
-    v = &mMgr.make<PointerType>();
-    v->sub = texp;
+    texp.push_back({ Obj::Kind::kPointerType });
+    v = std::move(texp);
     return p;
   }
 
@@ -616,20 +862,14 @@ EMPTY:
 }
 
 const char*
-Json2Asg::parse_args(const char* s, std::vector<Decl*>& v)
+Json2Asg::parse_args(const char* s, std::vector<Type>& v)
 {
   Type ty;
   auto p = parse_type(s, ty);
   if (!p)
     return s;
   s = p;
-  if (ty.texp)
-    ty.texp = turn_texp(ty.texp); // 将类型表达式内外翻转
-
-  std::vector<Decl*> params;
-  auto& decl = mMgr.make<Decl>();
-  decl.type = ty;
-  params.push_back(&decl);
+  v.push_back(ty);
 
   while (true) {
     p = match(skip_spaces(s), ",");
@@ -640,15 +880,9 @@ Json2Asg::parse_args(const char* s, std::vector<Decl*>& v)
     if (!p)
       return nullptr;
     s = p;
-    if (ty2.texp)
-      ty2.texp = turn_texp(ty2.texp); // 将类型表达式内外翻转
-
-    auto& decl = mMgr.make<Decl>();
-    decl.type = ty2;
-    v.push_back(&decl);
+    v.push_back(ty2);
   }
 
-  v = std::move(params);
   return s;
 }
 
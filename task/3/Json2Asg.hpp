@@ -1,63 +1,235 @@
 #pragma once
 
 #include "asg.hpp"
-#include <llvm/Support/JSON.h>
+#include "jsax.hpp"
+#include "typectx.hpp"
+#include <memory>
+#include <mutex>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace asg {
 
+/**
+ * @brief 从 clang 输出的 JSON 语法树直接构建语义图。
+ *
+ * 用 jsax::Reader 在输入文本上边读边建，不构建 JSON 的 DOM；不关心的属性和子树
+ * （TypedefDecl、隐式声明等）整段跳过，从不展开。
+ *
+ * 多线程时分两个阶段：先逐个读入顶层声明并登记编号，函数体只记下位置；再由
+ * 各线程领取函数体转换。函数体之间只通过顶层声明相互引用，第一阶段之后这些
+ * 都已登记好。每个线程有自己的 Json2Asg 和 Mgr，最后把节点并入 mMgr。
+ */
 class Json2Asg
 {
 public:
   Obj::Mgr& mMgr;
+  TypeCtx& mTypes;
 
-  Json2Asg(Obj::Mgr& mgr)
+  Json2Asg(Obj::Mgr& mgr, TypeCtx& types)
     : mMgr(mgr)
+    , mTypes(types)
   {
   }
 
-  TranslationUnit operator()(const llvm::json::Value& jval);
+  /// text 须比返回的语义图活得久；不是合法的 JSON 时抛出 jsax::Error。jobs
+  /// 是转换函数体的线程数，为 1 时在当前线程中边读边转换
+  TranslationUnit operator()(llvm::StringRef text, unsigned jobs = 1);
 
 private:
-  std::unordered_map<std::size_t, asg::Obj*> mIdMap;
+  /// 用到的节点种类，顺序与 Json2Asg.cpp 中 kKindNames 相同
+  enum class NodeKind : std::uint8_t
+  {
+    kTranslationUnitDecl,
+    kTypedefDecl,
+    kVarDecl,
+    kParmVarDecl,
+    kFunctionDecl,
+    kCompoundStmt,
+    kDeclStmt,
+    kExprStmt,
+    kReturnStmt,
+    kBinaryOperator,
+    kImplicitCastExpr,
+    kDeclRefExpr,
+    kIntegerLiteral,
+    kOther, // 读到了 kind，但不在上面
+    kNone,  // 还没有读到 kind
+  };
+
+  /**
+   * @brief 一个 JSON 对象中用到的属性，文本都指向输入。
+   *
+   * 读属性时遇到 inner 而 kind 已知，就停在 inner 上，由各节点的函数边读边处理
+   * 子节点；clang 的输出中 inner 总是最后一个键，走的都是这条路。inner 在 kind
+   * 之前时（例如按键排序的输出），先记下位置跳过，读完整个对象再回来。
+   */
+  struct Node
+  {
+    static constexpr std::size_t kNoInner = -1, kAtInner = -2;
+
+    NodeKind mKind{ NodeKind::kNone };
+    llvm::StringRef mId, mName, mQualType, mValueCategory, mOpcode, mCastKind,
+      mValue;
+    llvm::StringRef mRefId; // referencedDecl 的 id
+    bool mImplicit{ false };
+    std::size_t mInner{ kNoInner }; // inner 的位置，或者 kAtInner
+  };
+
+  std::unique_ptr<jsax::Reader> mReader;
+
+  /**
+   * @brief clang 的节点编号到声明的开放寻址散列表，线性探测。
+   *
+   * 编号是 clang 中节点的地址，稀疏而且低位总是 0，用乘法散列取高位。表长是
+   * 2 的幂，装载因子不超过 1/2。
+   */
+  class IdMap
+  {
+  public:
+    /// 编号已经存在时保留原来的节点
+    void insert(std::uint64_t id, Obj* obj)
+    {
+      if (2 * (mSize + 1) > mSlots.size())
+        grow();
+      auto& slot = mSlots[probe(id)];
+      if (slot.mObj == nullptr) {
+        slot = { id, obj };
+        ++mSize;
+      }
+    }
+
+    /// 没有时返回空指针
+    Obj* find(std::uint64_t id) const
+    {
+      return mSlots.empty() ? nullptr : mSlots[probe(id)].mObj;
+    }
+
+  private:
+    struct Slot
+    {
+      std::uint64_t mId;
+      Obj* mObj; // 为空表示空槽
+    };
+
+    std::vector<Slot> mSlots;
+    std::size_t mSize{ 0 };
+    int mShift{ 64 };
 
-  std::unordered_map<std::string, Type> mTyMap;
+    /// id 所在的槽，或者应当放入的空槽
+    std::size_t probe(std::uint64_t id) const
+    {
+      auto mask = mSlots.size() - 1;
+      auto i = std::size_t((id * 0x9e3779b97f4a7c15ull) >> mShift);
+      while (mSlots[i].mObj && mSlots[i].mId != id)
+        i = (i + 1) & mask;
+      return i;
+    }
+
+    void grow()
+    {
+      auto old = std::move(mSlots);
+      mSlots.assign(old.empty() ? 1024 : old.size() * 2, Slot{ 0, nullptr });
+      mShift = 64 - __builtin_ctzll(mSlots.size());
+      for (auto&& i : old) {
+        if (i.mObj)
+          mSlots[probe(i.mId)] = i;
+      }
+    }
+  };
+
+  IdMap mIdMap;
+
+  /// 推迟到第二阶段转换的函数体
+  struct Body
+  {
+    FunctionDecl* mFunc;
+    std::size_t mInner; // inner 的位置
+  };
 
+  std::vector<Body>* mBodies{ nullptr }; // 为空时不推迟
+
+  /// 第二阶段中各线程的 Json2Asg 指向第一阶段的那个，共用它的 mIdMap、mTypes
+  Json2Asg* mParent{ nullptr };
+  std::mutex mTypesMutex; // 第二阶段中保护 mTypes 和它的 Mgr
+
+  Json2Asg(Obj::Mgr& mgr, Json2Asg& parent)
+    : mMgr(mgr)
+    , mTypes(parent.mTypes)
+    , mParent(&parent)
+  {
+  }
+
+  /// 用 jobs 个线程转换 bodies 中的函数体
+  void convert_bodies(llvm::StringRef text,
+                      std::vector<Body>& bodies,
+                      unsigned jobs);
+
+  /// 先在本线程登记的声明中找，再到第一阶段登记的中找
+  Decl* find_decl(llvm::StringRef id) const;
+
+  /// 以 qualType 文本为键，键指向驻留池，查找时不必先驻留
+  std::unordered_map<std::string_view, Type> mTyMap;
+
+  /// 形如 0x1234 的节点编号，直接在输入上解析
+  static std::uint64_t parse_id(llvm::StringRef id);
+
+  /// 只有声明会被 referencedDecl 引用，其余节点不登记编号
   template<typename T, typename... Args>
-  T* make(std::size_t id, Args... args)
+  T* make(llvm::StringRef id, Args&&... args)
   {
-    auto& obj = mMgr.make<T>(args...);
-    mIdMap.emplace(id, &obj);
+    auto& obj = mMgr.make<T>(std::forward<Args>(args)...);
+    if constexpr (std::is_base_of_v<Decl, T>)
+      mIdMap.insert(parse_id(id), &obj);
     return &obj;
   }
 
-  FunctionDecl* cur_func; // 存放 ReturnStmt 对应的 FunctionDecl
+  FunctionDecl* cur_func; // 存放 ReturnStmt 对应的 FunctionDecl，按函数体设置
+
+  /// 读入对象的属性，直到对象结束或者停在 inner 上
+  void read_node(Node& node);
+  void read_attrs(Node& node);
+  void read_type(Node& node);
+  void read_ref(Node& node);
+
+  /// 依次以 node 的每个子节点调用 f，之后 node 的 inner 视为已经读过
+  template<typename F>
+  void inner(Node& node, F&& f);
+
+  /// 跳过没有读的 inner，读完对象剩下的属性
+  void finish(Node& node);
 
-  Type gety(const llvm::json::Object& jobj);
-  Expr::Cate getvc(const llvm::json::Object& jobj);
+  /// 读入一个子对象，以它调用 f，再读完它
+  template<typename F>
+  void child(F&& f);
 
-  Decl* decl(const llvm::json::Object& jobj);
-  VarDecl* var_decl(const llvm::json::Object& jobj);
-  FunctionDecl* function_decl(const llvm::json::Object& jobj);
+  Type gety(const Node& node);
+  Expr::Cate getvc(const Node& node);
+
+  Decl* decl(Node& node);
+  VarDecl* var_decl(Node& node);
+  FunctionDecl* function_decl(Node& node);
+  void function_body(FunctionDecl* obj, Node& node);
 
   //============================================================================
   // 表达式
   //============================================================================
-  Expr* expr(const llvm::json::Object& jobj);
-  BinaryExpr* binary_expr(const llvm::json::Object& jobj);
-  ImplicitCastExpr* implicit_cast_expr(const llvm::json::Object& jobj);
-  DeclRefExpr* declref_expr(const llvm::json::Object& jobj);
-  IntegerLiteral* integer_literal(const llvm::json::Object& jobj);
-  ExprStmt* expr_stmt(const llvm::json::Object& jobj);
+  Expr* expr(Node& node);
+  BinaryExpr* binary_expr(Node& node);
+  ImplicitCastExpr* implicit_cast_expr(Node& node);
+  DeclRefExpr* declref_expr(Node& node);
+  IntegerLiteral* integer_literal(Node& node);
+  ExprStmt* expr_stmt(Node& node);
 
   //============================================================================
   // 语句
   //============================================================================
 
-  Stmt* stmt(const llvm::json::Object& jobj);
-  CompoundStmt* compound_stmt(const llvm::json::Object& jobj);
-  DeclStmt* decl_stmt(const llvm::json::Object& jobj);
-  ReturnStmt* return_stmt(const llvm::json::Object& jobj);
+  Stmt* stmt(Node& node);
+  CompoundStmt* compound_stmt(Node& node);
+  DeclStmt* decl_stmt(Node& node);
+  ReturnStmt* return_stmt(Node& node);
 
 private:
   /**
@@ -66,14 +238,23 @@ private:
    */
   const char* parse_type(const char* s, Type& v);
 
-  /// 解析类型表达式，注意 \p v 在构建后是由外到内的顺序，需要再调用 turn_texp
-  /// 将内外翻转。
-  const char* parse_texp(const char* s, TypeExpr*& v);
-  const char* parse_texp_0(const char* s, TypeExpr*& v);
-  const char* parse_texp_1(const char* s, TypeExpr*& v);
-  const char* parse_texp_2(const char* s, TypeExpr*& v);
+  /// 类型表达式中的一层。TypeCtx 中的节点只能由内向外构建，解析时先把各层
+  /// 按由外到内的顺序记下，解析完再倒过来构建。
+  struct Layer
+  {
+    Obj::Kind mKind;
+    std::uint32_t mLen{ 0 };     // 数组的长度
+    std::vector<Type> mParams{}; // 函数的形参类型
+  };
+
+  using Layers = std::vector<Layer>;
+
+  const char* parse_texp(const char* s, Layers& v);
+  const char* parse_texp_0(const char* s, Layers& v);
+  const char* parse_texp_1(const char* s, Layers& v);
+  const char* parse_texp_2(const char* s, Layers& v);
 
-  const char* parse_args(const char* s, std::vector<Decl*>& v);
+  const char* parse_args(const char* s, std::vector<Type>& v);
 };
 
 } // namespace asg
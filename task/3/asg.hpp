@@ -1,9 +1,14 @@
 #pragma once
 
-#include <any>
+#include "atom.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
 /// 错误断言，打印文件和行号，方便定位问题。
@@ -29,14 +34,69 @@ using is_one_of = std::disjunction<std::is_same<T, Ts>...>;
 
 struct Obj
 {
-  std::any any; /// 留给遍历器存放任意数据
+  /**
+   * @brief 节点的具体类型。每个基类的子类排在一段连续的区间里，基类 T 的区间是
+   * [T::kKind, T::kLastKind]，判断是否是某个类型只需比较两次。
+   */
+  enum class Kind : std::uint8_t
+  {
+    kINVALID,
+
+    kTypeExpr,
+    kPointerType,
+    kArrayType,
+    kFunctionType,
+
+    kExpr,
+    kIntegerLiteral,
+    kStringLiteral,
+    kDeclRefExpr,
+    kParenExpr,
+    kUnaryExpr,
+    kBinaryExpr,
+    kCallExpr,
+    kInitListExpr,
+    kImplicitInitExpr,
+    kImplicitCastExpr,
+
+    kStmt,
+    kNullStmt,
+    kDeclStmt,
+    kExprStmt,
+    kCompoundStmt,
+    kIfStmt,
+    kWhileStmt,
+    kDoStmt,
+    kBreakStmt,
+    kContinueStmt,
+    kReturnStmt,
+
+    kDecl,
+    kVarDecl,
+    kFunctionDecl,
+  };
+
+  static constexpr std::uint32_t kNoId = UINT32_MAX;
+
+  /// 节点编号，同一个 Mgr 中从 0 开始连续分配，遍历器用它索引自己的 Table
+  std::uint32_t id{ kNoId };
+
+  Kind tag{ Kind::kINVALID }; /// 由 Mgr::make 填写
 
   virtual ~Obj() = default;
 
+  /// 是否是 T 或 T 的子类
+  template<typename T>
+  bool isa() const
+  {
+    return tag >= T::kKind && tag <= T::kLastKind;
+  }
+
+  /// 可能为空的指针请用 dyn_cast
   template<typename T>
   T* dcst()
   {
-    return dynamic_cast<T*>(this);
+    return isa<T>() ? static_cast<T*>(this) : nullptr;
   }
 
   template<typename T>
@@ -51,31 +111,176 @@ struct Obj
     return *reinterpret_cast<T*>(this);
   }
 
-  struct Mgr : public std::vector<std::unique_ptr<Obj>>
+  /**
+   * @brief 节点的内存池。每种节点类型一个 Slab，同类节点在大块内存中连续分配，
+   * Mgr 销毁时逐块整体释放。
+   *
+   * 销毁时在 Slab 内按具体类型逐个析构，不经过虚函数，也不必逐个释放内存。
+   */
+  class Mgr
   {
+  public:
+    Mgr() = default;
+    Mgr(const Mgr&) = delete;
+    Mgr& operator=(const Mgr&) = delete;
+
     template<typename T, typename... Args>
-    T& make(Args... args)
+    T& make(Args&&... args)
     {
-      auto ptr = std::make_unique<T>(args...);
-      auto& obj = *ptr;
-      emplace_back(std::move(ptr));
-      return obj;
+      auto& slab = this->slab<T>();
+      auto obj = new (slab.next()) T(std::forward<Args>(args)...);
+      slab.commit(); // 构造函数抛出异常时，这块内存不算已用
+      obj->tag = T::kKind;
+      obj->id = mCount++;
+      return *obj;
     }
+
+    /// 已创建的节点数
+    std::uint32_t size() const { return mCount; }
+
+    /**
+     * @brief 接管 other 中的全部节点，它们的编号改为接在本 Mgr 已有编号之后，
+     * other 变为空。多个线程各用一个 Mgr 建图，完成后并入同一个 Mgr。
+     */
+    void adopt(Mgr& other)
+    {
+      for (auto& slab : other.mSlabs) {
+        if (slab) {
+          slab->renumber(mCount);
+          mAdopted.push_back(std::move(slab));
+        }
+      }
+      for (auto& slab : other.mAdopted) {
+        slab->renumber(mCount);
+        mAdopted.push_back(std::move(slab));
+      }
+      mCount += other.mCount;
+      other.mSlabs.clear();
+      other.mAdopted.clear();
+      other.mCount = 0;
+    }
+
+  private:
+    std::uint32_t mCount{ 0 }; /// 下一个节点的编号
+
+    struct SlabBase
+    {
+      virtual ~SlabBase() = default;
+
+      /// 所有节点的编号加上 offset
+      virtual void renumber(std::uint32_t offset) = 0;
+    };
+
+    template<typename T>
+    class Slab : public SlabBase
+    {
+    public:
+      ~Slab() override
+      {
+        for (auto&& [begin, cap] : mChunks) {
+          auto end = begin == mChunks.back().first ? mNext : begin + cap;
+          for (auto p = begin; p != end; ++p)
+            p->T::~T();
+          std::allocator<T>().deallocate(begin, cap);
+        }
+      }
+
+      void renumber(std::uint32_t offset) override
+      {
+        for (auto&& [begin, cap] : mChunks) {
+          auto end = begin == mChunks.back().first ? mNext : begin + cap;
+          for (auto p = begin; p != end; ++p)
+            p->id += offset;
+        }
+      }
+
+      /// 下一个节点的位置，尚未构造
+      T* next()
+      {
+        if (mNext == mEnd) {
+          // 块的大小从 64 个节点开始倍增，最大 4096 个
+          std::size_t cap = mChunks.empty()
+                              ? 64
+                              : std::min<std::size_t>(mChunks.back().second * 2,
+                                                      4096);
+          auto chunk = std::allocator<T>().allocate(cap);
+          mChunks.emplace_back(chunk, cap);
+          mNext = chunk;
+          mEnd = chunk + cap;
+        }
+        return mNext;
+      }
+
+      void commit() { ++mNext; }
+
+    private:
+      std::vector<std::pair<T*, std::size_t>> mChunks;
+      T *mNext{ nullptr }, *mEnd{ nullptr };
+    };
+
+    std::vector<std::unique_ptr<SlabBase>> mSlabs;
+    std::vector<std::unique_ptr<SlabBase>> mAdopted; /// 从别的 Mgr 接管的
+
+    /// 每种节点类型在第一次用到时分到一个下标
+    static inline std::atomic<std::size_t> sTypeCount{ 0 };
+
+    template<typename T>
+    static std::size_t type_index()
+    {
+      static const std::size_t index = sTypeCount++;
+      return index;
+    }
+
+    template<typename T>
+    Slab<T>& slab()
+    {
+      auto index = type_index<T>();
+      if (index >= mSlabs.size())
+        mSlabs.resize(index + 1);
+      if (!mSlabs[index])
+        mSlabs[index] = std::make_unique<Slab<T>>();
+      return static_cast<Slab<T>&>(*mSlabs[index]);
+    }
+  };
+
+  /**
+   * @brief 以节点编号为下标的附加数据，每个遍历器各自持有所需的表，取代在节点
+   * 上存放任意数据。编号超出当前大小时自动扩容，新的项为 T 的默认值。
+   *
+   * Table<bool> 底层是 std::vector<bool>，即位图。
+   */
+  template<typename T>
+  class Table
+  {
+  public:
+    typename std::vector<T>::reference operator[](const Obj* obj)
+    {
+      ASSERT(obj->id != kNoId);
+      // 按倍数扩容，遍历时不断新建节点也不会频繁扩容
+      if (obj->id >= mData.size())
+        mData.resize(std::max<std::size_t>(obj->id + 1, mData.size() * 2));
+      return mData[obj->id];
+    }
+
+  private:
+    std::vector<T> mData;
   };
 
   /// 检查循环引用，防止无限递归。
   struct Walked
   {
+    Table<bool>& mWalked;
     Obj* mObj;
 
-    Walked(Obj* obj)
-      : mObj(obj)
+    Walked(Table<bool>& walked, Obj* obj)
+      : mWalked(walked)
+      , mObj(obj)
     {
-      ASSERT(!mObj->any.has_value());
-      mObj->any = nullptr;
+      ASSERT(!mWalked[mObj]);
+      mWalked[mObj] = true;
     }
 
-    ~Walked() { mObj->any.reset(); }
+    ~Walked() { mWalked[mObj] = false; }
   };
 
   /// 有限泛型的指针模板类
@@ -103,7 +308,7 @@ struct Obj
              typename = std::enable_if_t<is_one_of<T, Ts...>::value>>
     T* dcst()
     {
-      return dynamic_cast<T*>(mObj);
+      return mObj != nullptr ? mObj->dcst<T>() : nullptr;
     }
 
     template<typename T,
@@ -147,28 +352,45 @@ struct Type
   Spec spec{ Spec::kINVALID };
   Qual qual{ Qual::kNone };
 
-  TypeExpr* texp{ nullptr };
+  TypeExpr* texp{ nullptr }; /// 由 TypeCtx 唯一化，结构相同即指针相同
+
+  bool operator==(const Type& other) const
+  {
+    return spec == other.spec && qual == other.qual && texp == other.texp;
+  }
+
+  bool operator!=(const Type& other) const { return !(*this == other); }
 };
 
+/// 类型表达式节点一经创建就不再修改，都应通过 TypeCtx 获取
 struct TypeExpr : public Obj
 {
+  static constexpr Kind kKind = Kind::kTypeExpr,
+                        kLastKind = Kind::kFunctionType;
+
   TypeExpr* sub{ nullptr };
 };
 
 struct PointerType : public TypeExpr
 {
+  static constexpr Kind kKind = Kind::kPointerType, kLastKind = kKind;
+
   Type::Qual qual{ Type::Qual::kNone };
 };
 
 struct ArrayType : public TypeExpr
 {
+  static constexpr Kind kKind = Kind::kArrayType, kLastKind = kKind;
+
   std::uint32_t len{ 0 }; /// 数组长度，kUnLen 表示未知
   static constexpr std::uint32_t kUnLen = UINT32_MAX;
 };
 
 struct FunctionType : public TypeExpr
 {
-  std::vector<Decl*> params;
+  static constexpr Kind kKind = Kind::kFunctionType, kLastKind = kKind;
+
+  std::vector<Type> params; /// 形参的类型，形参的声明在 FunctionDecl 中
 };
 
 //==============================================================================
@@ -179,6 +401,9 @@ struct Decl;
 
 struct Expr : public Obj
 {
+  static constexpr Kind kKind = Kind::kExpr,
+                        kLastKind = Kind::kImplicitCastExpr;
+
   enum class Cate : std::uint8_t
   {
     kINVALID,
@@ -192,26 +417,36 @@ struct Expr : public Obj
 
 struct IntegerLiteral : public Expr
 {
+  static constexpr Kind kKind = Kind::kIntegerLiteral, kLastKind = kKind;
+
   std::uint64_t val{ 0 };
 };
 
 struct StringLiteral : public Expr
 {
-  std::string val;
+  static constexpr Kind kKind = Kind::kStringLiteral, kLastKind = kKind;
+
+  atom::Atom val;
 };
 
 struct DeclRefExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kDeclRefExpr, kLastKind = kKind;
+
   Decl* decl{ nullptr };
 };
 
 struct ParenExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kParenExpr, kLastKind = kKind;
+
   Expr* sub{ nullptr };
 };
 
 struct UnaryExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kUnaryExpr, kLastKind = kKind;
+
   enum Op
   {
     kINVALID,
@@ -226,6 +461,8 @@ struct UnaryExpr : public Expr
 
 struct BinaryExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kBinaryExpr, kLastKind = kKind;
+
   enum Op
   {
     kINVALID,
@@ -253,20 +490,28 @@ struct BinaryExpr : public Expr
 
 struct CallExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kCallExpr, kLastKind = kKind;
+
   Expr* head{ nullptr };
   std::vector<Expr*> args;
 };
 
 struct InitListExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kInitListExpr, kLastKind = kKind;
+
   std::vector<Expr*> list;
 };
 
 struct ImplicitInitExpr : public Expr
-{};
+{
+  static constexpr Kind kKind = Kind::kImplicitInitExpr, kLastKind = kKind;
+};
 
 struct ImplicitCastExpr : public Expr
 {
+  static constexpr Kind kKind = Kind::kImplicitCastExpr, kLastKind = kKind;
+
   enum
   {
     kINVALID,
@@ -286,56 +531,79 @@ struct ImplicitCastExpr : public Expr
 struct FunctionDecl;
 
 struct Stmt : public Obj
-{};
+{
+  static constexpr Kind kKind = Kind::kStmt,
+                        kLastKind = Kind::kReturnStmt;
+};
 
 struct NullStmt : public Stmt
-{};
+{
+  static constexpr Kind kKind = Kind::kNullStmt, kLastKind = kKind;
+};
 
 struct DeclStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kDeclStmt, kLastKind = kKind;
+
   std::vector<Decl*> decls;
 };
 
 struct ExprStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kExprStmt, kLastKind = kKind;
+
   Expr* expr{ nullptr };
 };
 
 struct CompoundStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kCompoundStmt, kLastKind = kKind;
+
   std::vector<Stmt*> subs;
 };
 
 struct IfStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kIfStmt, kLastKind = kKind;
+
   Expr* cond{ nullptr };
   Stmt *then{ nullptr }, *else_{ nullptr };
 };
 
 struct WhileStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kWhileStmt, kLastKind = kKind;
+
   Expr* cond{ nullptr };
   Stmt* body{ nullptr };
 };
 
 struct DoStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kDoStmt, kLastKind = kKind;
+
   Stmt* body{ nullptr };
   Expr* cond{ nullptr };
 };
 
 struct BreakStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kBreakStmt, kLastKind = kKind;
+
   Stmt* loop{ nullptr };
 };
 
 struct ContinueStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kContinueStmt, kLastKind = kKind;
+
   Stmt* loop{ nullptr };
 };
 
 struct ReturnStmt : public Stmt
 {
+  static constexpr Kind kKind = Kind::kReturnStmt, kLastKind = kKind;
+
   FunctionDecl* func{ nullptr };
   Expr* expr{ nullptr };
 };
@@ -346,21 +614,153 @@ struct ReturnStmt : public Stmt
 
 struct Decl : public Obj
 {
+  static constexpr Kind kKind = Kind::kDecl,
+                        kLastKind = Kind::kFunctionDecl;
+
   Type type;
-  std::string name;
+  atom::Atom name;
 };
 
 struct VarDecl : public Decl
 {
+  static constexpr Kind kKind = Kind::kVarDecl, kLastKind = kKind;
+
   Expr* init{ nullptr };
 };
 
 struct FunctionDecl : public Decl
 {
+  static constexpr Kind kKind = Kind::kFunctionDecl, kLastKind = kKind;
+
   std::vector<Decl*> params;
   CompoundStmt* body{ nullptr };
 };
 
 using TranslationUnit = std::vector<Decl*>;
 
+//==============================================================================
+// 类型判断与分派
+//==============================================================================
+
+/// obj 是否是 T 或 T 的子类，obj 不能为空
+template<typename T>
+bool
+isa(const Obj* obj)
+{
+  return obj->isa<T>();
+}
+
+/// 确定 obj 是 T 时使用，不是则中断
+template<typename T>
+T*
+cast(Obj* obj)
+{
+  ASSERT(obj->isa<T>());
+  return static_cast<T*>(obj);
+}
+
+/// obj 为空或不是 T 时返回空指针
+template<typename T>
+T*
+dyn_cast(Obj* obj)
+{
+  return obj != nullptr && obj->isa<T>() ? static_cast<T*>(obj) : nullptr;
+}
+
+/**
+ * @brief 按节点的具体类型分派：用 switch 一次跳转到对应的分支，以具体类型的
+ * 指针调用 visitor。各遍历器的 operator()(Expr*) 等都通过它分派。
+ *
+ * visitor 通常是泛型 lambda，对它不处理的类型用 if constexpr 中断。
+ */
+template<typename Visitor>
+decltype(auto)
+visit(TypeExpr* obj, Visitor&& visitor)
+{
+  switch (obj->tag) {
+    case Obj::Kind::kPointerType:
+      return visitor(static_cast<PointerType*>(obj));
+    case Obj::Kind::kArrayType:
+      return visitor(static_cast<ArrayType*>(obj));
+    case Obj::Kind::kFunctionType:
+      return visitor(static_cast<FunctionType*>(obj));
+    default:
+      ABORT();
+  }
+}
+
+template<typename Visitor>
+decltype(auto)
+visit(Expr* obj, Visitor&& visitor)
+{
+  switch (obj->tag) {
+    case Obj::Kind::kIntegerLiteral:
+      return visitor(static_cast<IntegerLiteral*>(obj));
+    case Obj::Kind::kStringLiteral:
+      return visitor(static_cast<StringLiteral*>(obj));
+    case Obj::Kind::kDeclRefExpr:
+      return visitor(static_cast<DeclRefExpr*>(obj));
+    case Obj::Kind::kParenExpr:
+      return visitor(static_cast<ParenExpr*>(obj));
+    case Obj::Kind::kUnaryExpr:
+      return visitor(static_cast<UnaryExpr*>(obj));
+    case Obj::Kind::kBinaryExpr:
+      return visitor(static_cast<BinaryExpr*>(obj));
+    case Obj::Kind::kCallExpr:
+      return visitor(static_cast<CallExpr*>(obj));
+    case Obj::Kind::kInitListExpr:
+      return visitor(static_cast<InitListExpr*>(obj));
+    case Obj::Kind::kImplicitInitExpr:
+      return visitor(static_cast<ImplicitInitExpr*>(obj));
+    case Obj::Kind::kImplicitCastExpr:
+      return visitor(static_cast<ImplicitCastExpr*>(obj));
+    default:
+      ABORT();
+  }
+}
+
+template<typename Visitor>
+decltype(auto)
+visit(Stmt* obj, Visitor&& visitor)
+{
+  switch (obj->tag) {
+    case Obj::Kind::kNullStmt:
+      return visitor(static_cast<NullStmt*>(obj));
+    case Obj::Kind::kDeclStmt:
+      return visitor(static_cast<DeclStmt*>(obj));
+    case Obj::Kind::kExprStmt:
+      return visitor(static_cast<ExprStmt*>(obj));
+    case Obj::Kind::kCompoundStmt:
+      return visitor(static_cast<CompoundStmt*>(obj));
+    case Obj::Kind::kIfStmt:
+      return visitor(static_cast<IfStmt*>(obj));
+    case Obj::Kind::kWhileStmt:
+      return visitor(static_cast<WhileStmt*>(obj));
+    case Obj::Kind::kDoStmt:
+      return visitor(static_cast<DoStmt*>(obj));
+    case Obj::Kind::kBreakStmt:
+      return visitor(static_cast<BreakStmt*>(obj));
+    case Obj::Kind::kContinueStmt:
+      return visitor(static_cast<ContinueStmt*>(obj));
+    case Obj::Kind::kReturnStmt:
+      return visitor(static_cast<ReturnStmt*>(obj));
+    default:
+      ABORT();
+  }
+}
+
+template<typename Visitor>
+decltype(auto)
+visit(Decl* obj, Visitor&& visitor)
+{
+  switch (obj->tag) {
+    case Obj::Kind::kVarDecl:
+      return visitor(static_cast<VarDecl*>(obj));
+    case Obj::Kind::kFunctionDecl:
+      return visitor(static_cast<FunctionDecl*>(obj));
+    default:
+      ABORT();
+  }
+}
+
 } // namespace asg
@@ -0,0 +1,178 @@
+#pragma once
+
+// 标识符和字符串的驻留（interning）：整个进程中相同的文本只存一份，之后用
+// Atom 代表它，比较只需比较指针，作为键只需处理一个整数。
+// task/2/common/atom.hpp 与 task/3/atom.hpp 是同一份文件，修改时请同步。
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace atom {
+
+namespace detail {
+
+/// 驻留的文本，创建后不再移动也不再释放
+struct Rep
+{
+  const char* mText;
+  std::uint32_t mSize;
+  std::uint32_t mId;
+};
+
+inline constexpr Rep kEmpty{ "", 0, 0 };
+
+} // namespace detail
+
+/**
+ * @brief 驻留后的文本，只有一个指针大小。文本相同当且仅当 Atom 相等；编号从 0
+ * 开始连续分配（0 是空串），可以直接作为数组下标。默认构造的 Atom 是空串。
+ */
+class Atom
+{
+public:
+  Atom() = default;
+
+  std::uint32_t id() const { return mRep->mId; }
+
+  std::string_view view() const { return { mRep->mText, mRep->mSize }; }
+
+  std::string str() const { return std::string(view()); }
+
+  /// 驻留的文本末尾总有 '\0'
+  const char* c_str() const { return mRep->mText; }
+
+  std::size_t size() const { return mRep->mSize; }
+
+  bool empty() const { return mRep->mSize == 0; }
+
+  bool operator==(Atom other) const { return mRep == other.mRep; }
+  bool operator!=(Atom other) const { return mRep != other.mRep; }
+
+private:
+  friend class Pool;
+
+  const detail::Rep* mRep{ &detail::kEmpty };
+
+  explicit Atom(const detail::Rep* rep)
+    : mRep(rep)
+  {
+  }
+};
+
+/**
+ * @brief 进程唯一的驻留池，可以在多个线程中同时使用。
+ *
+ * 池按文本的哈希值分成若干片，每片一把锁，各自存放文本。Atom 指向的内容创建
+ * 后不再改变，读取 Atom 不需要加锁。
+ */
+class Pool
+{
+public:
+  static Pool& global()
+  {
+    static Pool sPool;
+    return sPool;
+  }
+
+  Atom intern(std::string_view text)
+  {
+    if (text.empty())
+      return {};
+
+    Key key{ text, std::hash<std::string_view>()(text) };
+    auto& shard = mShards[key.mHash % kShards];
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+
+    auto iter = shard.mMap.find(key);
+    if (iter != shard.mMap.end())
+      return Atom(iter->second);
+
+    auto stored = shard.store(text);
+    auto& rep = shard.mReps.emplace_back(detail::Rep{
+      stored, std::uint32_t(text.size()), mNextId.fetch_add(1) });
+    shard.mMap.emplace(Key{ { stored, text.size() }, key.mHash }, &rep);
+    return Atom(&rep);
+  }
+
+  /// 已分配的编号数，所有 Atom 的编号都小于它
+  std::size_t size() const { return mNextId.load(); }
+
+private:
+  Pool() = default;
+
+  /// 哈希值只在选片时算一次，存在键中
+  struct Key
+  {
+    std::string_view mText;
+    std::size_t mHash;
+
+    bool operator==(const Key& other) const { return mText == other.mText; }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const { return key.mHash; }
+  };
+
+  struct Shard
+  {
+    std::mutex mMutex;
+    std::unordered_map<Key, const detail::Rep*, KeyHash> mMap;
+    std::deque<detail::Rep> mReps;
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    char* mCur{ nullptr };
+    std::size_t mLeft{ 0 };
+
+    /// 把文本复制到大块内存中，末尾补 '\0'
+    const char* store(std::string_view text)
+    {
+      constexpr std::size_t kBlock = 64 * 1024;
+      auto need = text.size() + 1;
+      if (need > mLeft) {
+        auto size = std::max(need, kBlock);
+        mBlocks.emplace_back(new char[size]);
+        mCur = mBlocks.back().get();
+        mLeft = size;
+      }
+      auto ret = mCur;
+      std::memcpy(mCur, text.data(), text.size());
+      mCur[text.size()] = '\0';
+      mCur += need;
+      mLeft -= need;
+      return ret;
+    }
+  };
+
+  static constexpr std::size_t kShards = 16;
+
+  std::atomic<std::uint32_t> mNextId{ 1 }; // 0 留给空串
+  Shard mShards[kShards];
+};
+
+/// 在全局驻留池中驻留 text
+inline Atom
+intern(std::string_view text)
+{
+  return Pool::global().intern(text);
+}
+
+} // namespace atom
+
+namespace std {
+
+template<>
+struct hash<atom::Atom>
+{
+  std::size_t operator()(atom::Atom atom) const { return atom.id(); }
+};
+
+} // namespace std
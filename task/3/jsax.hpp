@@ -0,0 +1,429 @@
+#pragma once
+
+// 流式（SAX 风格）的 JSON 读取：直接在输入缓冲区上逐个读出对象、数组和字符串，
+// 不构建 DOM。不需要的值用 skip() 整段跳过，只匹配括号和引号。
+
+#include "atom.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define JSAX_SSE2 1
+#endif
+
+namespace jsax {
+
+namespace detail {
+
+/// skip() 关心的字符在一块 64 字节中的位置，第 i 位对应第 i 个字节
+struct Block
+{
+  std::uint64_t mQuote, mBackslash, mOpen, mClose;
+};
+
+/// 字符的类别，没有 SSE2 时查表
+struct Classes
+{
+  std::uint8_t mOf[256]{};
+
+  constexpr Classes()
+  {
+    mOf[std::uint8_t('"')] = 1;
+    mOf[std::uint8_t('\\')] = 2;
+    mOf[std::uint8_t('{')] = mOf[std::uint8_t('[')] = 4;
+    mOf[std::uint8_t('}')] = mOf[std::uint8_t(']')] = 8;
+  }
+};
+
+inline constexpr Classes kClasses;
+
+inline Block
+classify(const char* p)
+{
+  Block ret{ 0, 0, 0, 0 };
+#ifdef JSAX_SSE2
+  // '[' 与 ']' 置上 0x20 位就是 '{' 与 '}'，与原本的 '{'、'}' 一起比较
+  for (int i = 0; i < 64; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    auto bits = [&](__m128i x, char c) {
+      return std::uint64_t(std::uint16_t(
+               _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)))))
+             << i;
+    };
+    ret.mQuote |= bits(v, '"');
+    ret.mBackslash |= bits(v, '\\');
+    ret.mOpen |= bits(lower, '{');
+    ret.mClose |= bits(lower, '}');
+  }
+#else
+  for (int i = 0; i < 64; ++i) {
+    auto c = kClasses.mOf[std::uint8_t(p[i])];
+    ret.mQuote |= std::uint64_t(c & 1) << i;
+    ret.mBackslash |= std::uint64_t(c >> 1 & 1) << i;
+    ret.mOpen |= std::uint64_t(c >> 2 & 1) << i;
+    ret.mClose |= std::uint64_t(c >> 3 & 1) << i;
+  }
+#endif
+  return ret;
+}
+
+/// 第 i 位是第 0 ~ i 位的异或，引号之间（含开头的引号）的位置为 1
+inline std::uint64_t
+prefix_xor(std::uint64_t x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+} // namespace detail
+
+/// 输入不是合法的 JSON
+struct Error
+{
+  std::size_t mOffset; // 出错位置距输入开头的字节数
+  const char* mWhat;
+};
+
+/**
+ * @brief 拉取式的 JSON 读取器，由调用者按 JSON 的结构依次调用。
+ *
+ * 对象：begin_object() 后反复调用 next_key()，返回 false 时对象已读完；数组
+ * 同理，用 begin_array() 与 next_elem()。每个键或元素之后必须恰好读入或跳过一
+ * 个值。tell() 与 seek() 可以记下一个值的位置，稍后回来重新读。
+ *
+ * 不含转义的字符串直接指向输入缓冲区；含转义的解码后放入驻留池。两种情况下
+ * 返回的文本都与输入缓冲区活得一样久。
+ */
+class Reader
+{
+public:
+  explicit Reader(llvm::StringRef text)
+    : mBegin(text.begin())
+    , mCur(text.begin())
+    , mEnd(text.end())
+  {
+  }
+
+  void begin_object()
+  {
+    expect('{');
+    mFirst = true;
+  }
+
+  /// 读入下一个键和其后的冒号，遇到 '}' 时返回 false
+  bool next_key(llvm::StringRef& key)
+  {
+    if (!next('}'))
+      return false;
+    if (ws() != '"')
+      fail("expected a key");
+    key = string();
+    expect(':');
+    return true;
+  }
+
+  void begin_array()
+  {
+    expect('[');
+    mFirst = true;
+  }
+
+  /// 移到下一个元素，遇到 ']' 时返回 false
+  bool next_elem() { return next(']'); }
+
+  llvm::StringRef string()
+  {
+    expect('"');
+    auto begin = mCur;
+    // memchr 按字长比较，比逐个字符找快
+    auto quote = find(begin, mEnd, '"');
+    if (!quote)
+      fail("unterminated string");
+    if (auto bs = find(begin, quote, '\\')) {
+      mCur = bs;
+      return unescape(begin);
+    }
+    mCur = quote + 1;
+    return { begin, std::size_t(quote - begin) };
+  }
+
+  bool boolean()
+  {
+    if (ws() == 't' && literal("true"))
+      return true;
+    if (literal("false"))
+      return false;
+    fail("expected a boolean");
+  }
+
+  /// 跳过一个值。只匹配括号与引号，不检查其中的语法
+  void skip()
+  {
+    auto c = ws();
+    if (c == '"') {
+      skip_string();
+      return;
+    }
+    if (c != '{' && c != '[') {
+      // 数字、true、false、null
+      while (mCur != mEnd && !std::strchr(",:]} \t\r\n", *mCur))
+        ++mCur;
+      return;
+    }
+
+    // 两阶段的 Json2Asg 在第一阶段跳过所有函数体，这里是它的瓶颈。每次分类
+    // 64 个字节：用前缀异或算出哪些字节在字符串里，其余的括号才算数；只有在
+    // 深度可能归零的那一块才逐个数括号
+    std::size_t depth = 0;
+    std::uint64_t inString = 0; // 上一块结束时在字符串中为全 1
+    std::uint64_t carry = 0;    // 上一块末尾的反斜杠转义了本块的第一个字节
+    char tail[64];
+    for (auto p = mCur; p < mEnd; p += 64) {
+      auto base = p;
+      if (mEnd - p < 64) {
+        // 最后不足一块时补上空格，不读越界
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, p, mEnd - p);
+        base = tail;
+      }
+
+      auto block = detail::classify(base);
+      if (block.mBackslash | carry) {
+        // 转义很少见，逐个处理；字符串外不会有反斜杠
+        auto escaped = carry;
+        carry = 0;
+        for (auto m = block.mBackslash; m != 0; m &= m - 1) {
+          auto i = __builtin_ctzll(m);
+          if (escaped >> i & 1)
+            continue;
+          if (i == 63)
+            carry = 1;
+          else
+            escaped |= 2ull << i;
+        }
+        block.mQuote &= ~escaped;
+      }
+
+      auto str = detail::prefix_xor(block.mQuote) ^ inString;
+      inString = std::uint64_t(std::int64_t(str) >> 63);
+      auto open = block.mOpen & ~str, close = block.mClose & ~str;
+
+      auto closes = std::size_t(__builtin_popcountll(close));
+      if (closes < depth) {
+        depth += __builtin_popcountll(open);
+        depth -= closes;
+        continue;
+      }
+      for (auto m = open | close; m != 0; m &= m - 1) {
+        auto i = __builtin_ctzll(m);
+        if (open >> i & 1)
+          ++depth;
+        else if (--depth == 0) {
+          mCur = p + i + 1;
+          return;
+        }
+      }
+    }
+    mCur = mEnd;
+    fail("unterminated value");
+  }
+
+  /// 全部输入读完，之后只能有空白
+  void end()
+  {
+    if (ws() != '\0' || mCur != mEnd)
+      fail("trailing characters");
+  }
+
+  std::size_t tell() const { return mCur - mBegin; }
+
+  /// 回到 tell() 记下的位置，该位置必须在一个值的开头或结尾
+  void seek(std::size_t pos)
+  {
+    mCur = mBegin + pos;
+    mFirst = false;
+  }
+
+private:
+  const char* mBegin;
+  const char* mCur;
+  const char* mEnd;
+  bool mFirst{ false }; // 当前对象或数组中还没有读过键或元素
+  std::string mScratch;
+
+  [[noreturn]] void fail(const char* what) { throw Error{ tell(), what }; }
+
+  static const char* find(const char* begin, const char* end, char c)
+  {
+    return static_cast<const char*>(std::memchr(begin, c, end - begin));
+  }
+
+  /// 跳过空白，返回下一个字符，输入结束时返回 '\0'
+  char ws()
+  {
+    while (mCur != mEnd &&
+           (*mCur == ' ' || *mCur == '\n' || *mCur == '\r' || *mCur == '\t'))
+      ++mCur;
+    return mCur == mEnd ? '\0' : *mCur;
+  }
+
+  void expect(char c)
+  {
+    if (ws() != c)
+      fail("unexpected character");
+    ++mCur;
+  }
+
+  bool literal(const char* text)
+  {
+    auto len = std::strlen(text);
+    if (std::size_t(mEnd - mCur) < len || std::memcmp(mCur, text, len) != 0)
+      return false;
+    mCur += len;
+    return true;
+  }
+
+  /// 处理键或元素之间的逗号，遇到 close 时消耗它并返回 false
+  bool next(char close)
+  {
+    auto c = ws();
+    if (c == close) {
+      ++mCur;
+      mFirst = false; // 刚读完的容器是外层的一个值
+      return false;
+    }
+    if (!mFirst) {
+      if (c != ',')
+        fail("expected ','");
+      ++mCur;
+    }
+    mFirst = false;
+    return true;
+  }
+
+  void skip_string()
+  {
+    ++mCur;
+    while (true) {
+      auto quote = find(mCur, mEnd, '"');
+      if (!quote)
+        fail("unterminated string");
+      // 引号前连续的反斜杠是奇数个时，引号是转义出来的
+      auto bs = quote;
+      while (bs != mCur && bs[-1] == '\\')
+        --bs;
+      mCur = quote + 1;
+      if ((quote - bs) % 2 == 0)
+        return;
+    }
+  }
+
+  /// 从 begin 开始解码含转义的字符串，mCur 停在第一个反斜杠上
+  llvm::StringRef unescape(const char* begin)
+  {
+    mScratch.assign(begin, mCur);
+    while (true) {
+      if (mCur == mEnd)
+        fail("unterminated string");
+      char c = *mCur++;
+      if (c == '"')
+        break;
+      if (c != '\\') {
+        mScratch.push_back(c);
+        continue;
+      }
+      if (mCur == mEnd)
+        fail("unterminated string");
+      switch (c = *mCur++) {
+        case '"':
+        case '\\':
+        case '/':
+          mScratch.push_back(c);
+          break;
+        case 'b':
+          mScratch.push_back('\b');
+          break;
+        case 'f':
+          mScratch.push_back('\f');
+          break;
+        case 'n':
+          mScratch.push_back('\n');
+          break;
+        case 'r':
+          mScratch.push_back('\r');
+          break;
+        case 't':
+          mScratch.push_back('\t');
+          break;
+        case 'u':
+          utf8(code_point());
+          break;
+        default:
+          fail("invalid escape");
+      }
+    }
+    return atom::intern(mScratch).view();
+  }
+
+  /// 读入 \u 之后的码位，代理对合并成一个
+  std::uint32_t code_point()
+  {
+    auto cp = hex4();
+    if (cp >= 0xd800 && cp < 0xdc00 && literal("\\u")) {
+      auto lo = hex4();
+      if (lo < 0xdc00 || lo >= 0xe000)
+        fail("invalid surrogate pair");
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+    }
+    return cp;
+  }
+
+  std::uint32_t hex4()
+  {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i, ++mCur) {
+      if (mCur == mEnd)
+        fail("unterminated string");
+      char c = *mCur;
+      if (c >= '0' && c <= '9')
+        v = v << 4 | (c - '0');
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        v = v << 4 | ((c | 0x20) - 'a' + 10);
+      else
+        fail("invalid \\u escape");
+    }
+    return v;
+  }
+
+  void utf8(std::uint32_t cp)
+  {
+    if (cp < 0x80)
+      mScratch.push_back(char(cp));
+    else if (cp < 0x800) {
+      mScratch.push_back(char(0xc0 | cp >> 6));
+      mScratch.push_back(char(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+      mScratch.push_back(char(0xe0 | cp >> 12));
+      mScratch.push_back(char(0x80 | (cp >> 6 & 0x3f)));
+      mScratch.push_back(char(0x80 | (cp & 0x3f)));
+    } else {
+      mScratch.push_back(char(0xf0 | cp >> 18));
+      mScratch.push_back(char(0x80 | (cp >> 12 & 0x3f)));
+      mScratch.push_back(char(0x80 | (cp >> 6 & 0x3f)));
+      mScratch.push_back(char(0x80 | (cp & 0x3f)));
+    }
+  }
+};
+
+} // namespace jsax
@@ -1,6 +1,11 @@
+#include "Bin2Asg.hpp"
 #include "EmitIR.hpp"
 #include "Json2Asg.hpp"
 #include "asg.hpp"
+#include "prof.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <llvm/IR/Verifier.h>
@@ -9,17 +14,46 @@
 int
 main(int argc, char* argv[])
 {
+  auto prog = argv[0];
+
+  // --format=bin：输入是实验二用 --format=bin 写出的二进制语义图，默认是 JSON
+  // --jobs <n>：读 JSON 时用 n 个线程并行转换函数体，结果与单线程相同
+  // --time-report[=<file>]：结束时打印各阶段的耗时和内存，可另存为 JSON
+  bool bin = false;
+  unsigned jobs = 1;
+  while (argc > 3) {
+    if (prof::Report::global().parse_flag(argv[1]))
+      ++argv, --argc;
+    else if (std::strcmp(argv[1], "--format=json") == 0)
+      bin = false, ++argv, --argc;
+    else if (std::strcmp(argv[1], "--format=bin") == 0)
+      bin = true, ++argv, --argc;
+    else if (argc > 4 && std::strcmp(argv[1], "--jobs") == 0) {
+      jobs = std::max(1, std::atoi(argv[2]));
+      argv += 2, argc -= 2;
+    } else
+      break;
+  }
+
   if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
+    std::cout << "Usage: " << prog
+              << " [--format=json|bin] [--jobs <n>] [--time-report[=<file>]]"
+                 " <input> <output>\n";
     return -1;
   }
 
-  auto InFileOrErr = llvm::MemoryBuffer::getFile(argv[1]);
+  prof::Timer readTimer("read");
+  // 读取器不需要结尾的 '\0'，这样大文件总能直接映射到内存，映射的起点按页
+  // 对齐，二进制格式可以直接在上面访问
+  auto InFileOrErr = llvm::MemoryBuffer::getFile(
+    argv[1], /*IsText=*/false, /*RequiresNullTerminator=*/false);
   if (auto Err = InFileOrErr.getError()) {
     std::cout << "Error: unable to open input file: " << argv[1] << '\n';
     return -2;
   }
   auto InFile = std::move(InFileOrErr.get());
+  readTimer.stop();
+  prof::count("read", "bytes", InFile->getBufferSize());
 
   std::error_code ec;
   llvm::StringRef outPath(argv[2]);
@@ -29,21 +63,49 @@ main(int argc, char* argv[])
     return -3;
   }
 
-  auto json = llvm::json::parse(InFile->getBuffer());
-  if (!json) {
-    std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
-    return 1;
-  }
-
   asg::Obj::Mgr mgr;
-  asg::Json2Asg json2asg(mgr);
-  auto asg = json2asg(json.get());
+  asg::TypeCtx types(mgr);
+  asg::TranslationUnit asg;
+  if (bin) {
+    asg::Bin2Asg bin2asg(mgr, types);
+    try {
+      asg =
+        prof::timed("Bin2Asg", [&] { return bin2asg(InFile->getBuffer()); });
+    } catch (const asg::Bin2Asg::Error& e) {
+      std::cout << "Error: unable to parse input file: " << argv[1] << " ("
+                << e.mWhat << ")\n";
+      return 1;
+    }
+    prof::count("Bin2Asg", "nodes", mgr.size());
+  } else {
+    // 边读 JSON 边构建语义图，不再先解析成 DOM
+    asg::Json2Asg json2asg(mgr, types);
+    try {
+      asg = prof::timed("Json2Asg",
+                        [&] { return json2asg(InFile->getBuffer(), jobs); });
+    } catch (const jsax::Error& e) {
+      std::cout << "Error: unable to parse input file: " << argv[1] << " ("
+                << e.mWhat << " at offset " << e.mOffset << ")\n";
+      return 1;
+    }
+    prof::count("Json2Asg", "nodes", mgr.size());
+  }
 
   llvm::LLVMContext ctx;
   asg::EmitIR emitIR(ctx);
+  prof::Timer emitTimer("EmitIR");
   auto& mod = emitIR(asg);
+  emitTimer.stop();
+  prof::count("EmitIR", "instructions", mod.getInstructionCount());
+
+  prof::timed("print", [&] {
+    mod.print(outFile, nullptr, false, true);
+    outFile.flush();
+  });
+  auto broken = prof::timed(
+    "verify", [&] { return llvm::verifyModule(mod, &llvm::outs()); });
 
-  mod.print(outFile, nullptr, false, true);
-  if (llvm::verifyModule(mod, &llvm::outs()))
-    return 3;
+  if (!prof::Report::global().finish())
+    std::cerr << "Failed to write the time report\n";
+  return broken ? 3 : 0;
 }
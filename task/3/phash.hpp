@@ -0,0 +1,92 @@
+#pragma once
+
+// 编译期构造的完美散列表，把一组固定的词（JSON 中的键、kind、opcode 等）映射
+// 为它们的序号，一次散列加一次比较即可分类，不必逐个比较字符串。
+
+#include <cstdint>
+#include <string_view>
+
+namespace phash {
+
+/// 词的指纹：长度与首、中、尾三个字符，词不能为空
+constexpr std::uint32_t
+mix(std::string_view s)
+{
+  return std::uint32_t(s.size()) << 24 ^
+         std::uint32_t(std::uint8_t(s[0])) << 16 ^
+         std::uint32_t(std::uint8_t(s[s.size() / 2])) << 8 ^
+         std::uint8_t(s.back());
+}
+
+/**
+ * @brief N 个词的完美散列表，槽数为不小于 2N 的 2 的幂。
+ *
+ * 构造时依次尝试乘数，直到所有词的指纹乘以它后的高位两两不同。两个词的指纹
+ * 相同时找不到乘数，ok() 为假，用 static_assert 检查。
+ */
+template<std::size_t N>
+class Table
+{
+public:
+  constexpr explicit Table(const std::string_view (&words)[N])
+    : mWords{}
+    , mSlots{}
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      mWords[i] = words[i];
+
+    for (std::uint32_t seed = 1; seed < (1u << 24); seed += 2) {
+      if (fill(seed)) {
+        mSeed = seed;
+        return;
+      }
+    }
+  }
+
+  constexpr bool ok() const { return mSeed != 0; }
+
+  /// s 是第几个词，不在表中时返回 -1
+  int find(std::string_view s) const
+  {
+    if (s.empty())
+      return -1;
+    int i = mSlots[slot(s, mSeed)];
+    return i >= 0 && mWords[i] == s ? i : -1;
+  }
+
+private:
+  static constexpr int bits()
+  {
+    int ret = 1;
+    while ((std::size_t(1) << ret) < 2 * N)
+      ++ret;
+    return ret;
+  }
+
+  static constexpr int kBits = bits();
+  static constexpr std::size_t kSlots = std::size_t(1) << kBits;
+
+  std::string_view mWords[N];
+  std::int8_t mSlots[kSlots];
+  std::uint32_t mSeed{ 0 };
+
+  static constexpr std::size_t slot(std::string_view s, std::uint32_t seed)
+  {
+    return std::uint32_t(mix(s) * seed) >> (32 - kBits);
+  }
+
+  constexpr bool fill(std::uint32_t seed)
+  {
+    for (auto& i : mSlots)
+      i = -1;
+    for (std::size_t i = 0; i < N; ++i) {
+      auto& s = mSlots[slot(mWords[i], seed)];
+      if (s != -1)
+        return false;
+      s = std::int8_t(i);
+    }
+    return true;
+  }
+};
+
+} // namespace phash
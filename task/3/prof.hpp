@@ -0,0 +1,261 @@
+#pragma once
+
+// 分阶段的耗时与内存统计，相当于 clang 的 -ftime-report。各个 main.cpp 解析
+// 到 --time-report 时开启，未开启时计时器什么也不做。
+// task/1/common/prof.hpp、task/2/common/prof.hpp 与 task/3/prof.hpp 是同一份
+// 文件，修改时请同步。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+
+namespace prof {
+
+using Clock = std::chrono::steady_clock;
+
+/// 进程的资源用量
+struct Usage
+{
+  double mCpu{ 0 };   // 用户态加内核态的 CPU 秒，包括所有线程
+  long mPeakKb{ 0 };  // 峰值常驻内存
+};
+
+inline Usage
+usage()
+{
+  struct rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  auto secs = [](const timeval& tv) { return tv.tv_sec + tv.tv_usec * 1e-6; };
+  return { secs(ru.ru_utime) + secs(ru.ru_stime), ru.ru_maxrss };
+}
+
+/// 一个阶段的累计数据，批量处理多个文件时同名阶段累加
+struct Phase
+{
+  std::string mName;
+  std::size_t mCalls{ 0 };
+  double mWall{ 0 };
+  double mCpu{ 0 };
+  long mPeakKb{ 0 }; // 阶段结束时进程的峰值内存，峰值只增不减
+  std::vector<std::pair<std::string, std::uint64_t>> mCounts;
+};
+
+/**
+ * @brief 全进程一份的统计报告。阶段按第一次出现的顺序排列，计数（节点数、
+ * 指令数等）挂在阶段下面。
+ */
+class Report
+{
+public:
+  static Report& global()
+  {
+    static Report sReport;
+    return sReport;
+  }
+
+  /// 识别 --time-report 与 --time-report=<file>，后者另外把报告写成 JSON
+  bool parse_flag(const char* arg)
+  {
+    static constexpr char kFlag[] = "--time-report";
+    constexpr auto kLen = sizeof(kFlag) - 1;
+    if (std::strncmp(arg, kFlag, kLen) != 0)
+      return false;
+    if (arg[kLen] == '=' && arg[kLen + 1] != '\0')
+      mJsonPath = arg + kLen + 1;
+    else if (arg[kLen] != '\0')
+      return false;
+    mEnabled = true;
+    return true;
+  }
+
+  bool enabled() const { return mEnabled; }
+
+  Phase& phase(const char* name)
+  {
+    for (auto&& i : mPhases) {
+      if (i.mName == name)
+        return i;
+    }
+    auto& ret = mPhases.emplace_back();
+    ret.mName = name;
+    return ret;
+  }
+
+  /// 给阶段 phaseName 的计数 countName 加上 n
+  void count(const char* phaseName, const char* countName, std::uint64_t n)
+  {
+    if (!mEnabled)
+      return;
+    auto& counts = phase(phaseName).mCounts;
+    for (auto&& [name, value] : counts) {
+      if (name == countName) {
+        value += n;
+        return;
+      }
+    }
+    counts.emplace_back(countName, n);
+  }
+
+  /// 开启时把表格打印到 out，设置了文件时再写 JSON，写文件失败时返回 false
+  bool finish(std::FILE* out = stderr) const
+  {
+    if (!mEnabled)
+      return true;
+
+    auto total = usage();
+    double wall = std::chrono::duration<double>(Clock::now() - mBegin).count();
+
+    cell(out, "阶段", -12);
+    cell(out, "次数", 7);
+    cell(out, "墙钟秒", 11);
+    cell(out, "CPU秒", 11);
+    cell(out, "峰值内存MB", 12);
+    std::fputs("  计数\n", out);
+    for (auto&& i : mPhases) {
+      cell(out, i.mName.c_str(), -12);
+      std::fprintf(out,
+                   "%7zu%11.4f%11.4f%12.1f",
+                   i.mCalls,
+                   i.mWall,
+                   i.mCpu,
+                   i.mPeakKb / 1024.0);
+      for (auto&& [name, value] : i.mCounts)
+        std::fprintf(out, "  %s=%llu", name.c_str(), (unsigned long long)value);
+      std::fputc('\n', out);
+    }
+    cell(out, "总计", -12);
+    std::fprintf(out,
+                 "%7s%11.4f%11.4f%12.1f\n",
+                 "",
+                 wall,
+                 total.mCpu,
+                 total.mPeakKb / 1024.0);
+
+    return mJsonPath.empty() || write_json(wall, total);
+  }
+
+private:
+  bool mEnabled{ false };
+  std::string mJsonPath;
+  Clock::time_point mBegin{ Clock::now() };
+  std::vector<Phase> mPhases;
+
+  Report() = default;
+
+  /// 按显示宽度对齐输出 text，汉字占两列；width 为负时左对齐
+  static void cell(std::FILE* out, const char* text, int width)
+  {
+    int cols = 0;
+    for (auto p = text; *p; ++p) {
+      auto c = static_cast<unsigned char>(*p);
+      if ((c & 0xc0) != 0x80)
+        cols += c >= 0xe0 ? 2 : 1; // 三字节以上的 UTF-8 序列按汉字算
+    }
+    int pad = std::max((width < 0 ? -width : width) - cols, 0);
+    if (width > 0)
+      std::fprintf(out, "%*s", pad, "");
+    std::fputs(text, out);
+    if (width < 0)
+      std::fprintf(out, "%*s", pad, "");
+  }
+
+  /// 阶段名和计数名都是程序里写定的，不含需要转义的字符
+  bool write_json(double wall, const Usage& total) const
+  {
+    auto file = std::fopen(mJsonPath.c_str(), "w");
+    if (!file)
+      return false;
+
+    std::fprintf(file, "{\"phases\":[");
+    for (std::size_t i = 0; i < mPhases.size(); ++i) {
+      auto& p = mPhases[i];
+      std::fprintf(file,
+                   "%s{\"name\":\"%s\",\"calls\":%zu,\"wall\":%.6f,"
+                   "\"cpu\":%.6f,\"peak_rss_kb\":%ld,\"counts\":{",
+                   i ? "," : "",
+                   p.mName.c_str(),
+                   p.mCalls,
+                   p.mWall,
+                   p.mCpu,
+                   p.mPeakKb);
+      for (std::size_t j = 0; j < p.mCounts.size(); ++j)
+        std::fprintf(file,
+                     "%s\"%s\":%llu",
+                     j ? "," : "",
+                     p.mCounts[j].first.c_str(),
+                     (unsigned long long)p.mCounts[j].second);
+      std::fprintf(file, "}}");
+    }
+    std::fprintf(file,
+                 "],\"total\":{\"wall\":%.6f,\"cpu\":%.6f,"
+                 "\"peak_rss_kb\":%ld}}\n",
+                 wall,
+                 total.mCpu,
+                 total.mPeakKb);
+    return std::fclose(file) == 0;
+  }
+};
+
+/**
+ * @brief 作用域计时器，析构或 stop() 时把这段时间计入阶段 name。name 必须比
+ * 计时器活得久，通常是字符串常量。
+ */
+class Timer
+{
+public:
+  explicit Timer(const char* name)
+    : mName(Report::global().enabled() ? name : nullptr)
+  {
+    if (mName) {
+      mWall = Clock::now();
+      mCpu = usage().mCpu;
+    }
+  }
+
+  ~Timer() { stop(); }
+
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+
+  void stop()
+  {
+    if (!mName)
+      return;
+    auto now = usage();
+    auto& phase = Report::global().phase(mName);
+    ++phase.mCalls;
+    phase.mWall += std::chrono::duration<double>(Clock::now() - mWall).count();
+    phase.mCpu += now.mCpu - mCpu;
+    phase.mPeakKb = std::max(phase.mPeakKb, now.mPeakKb);
+    mName = nullptr;
+  }
+
+private:
+  const char* mName;
+  Clock::time_point mWall;
+  double mCpu{ 0 };
+};
+
+/// 把 f() 的耗时计入阶段 name，返回 f() 的结果
+template<typename F>
+decltype(auto)
+timed(const char* name, F&& f)
+{
+  Timer timer(name);
+  return f();
+}
+
+/// 开启统计时给阶段 phaseName 的计数 countName 加上 n
+inline void
+count(const char* phaseName, const char* countName, std::uint64_t n)
+{
+  Report::global().count(phaseName, countName, n);
+}
+
+} // namespace prof
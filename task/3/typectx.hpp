@@ -0,0 +1,110 @@
+#pragma once
+
+// 类型表达式的唯一化（hash-consing）。
+// task/2/common/typectx.hpp 与 task/3/typectx.hpp 是同一份文件，修改时请同步。
+
+#include "asg.hpp"
+#include <functional>
+#include <unordered_map>
+
+namespace asg {
+
+/**
+ * @brief 类型表达式的唯一化表，做法与 llvm::LLVMContext 相同：结构相同的
+ * TypeExpr 只创建一次，之后总是返回同一个节点，所以类型相等就是指针相等。
+ *
+ * 返回的节点是共享的，不能修改。需要另一个类型（比如补全数组长度）时，应重新
+ * 向 TypeCtx 要一个。节点由 Mgr 分配，TypeCtx 的生存期不能超过 Mgr。
+ */
+class TypeCtx
+{
+public:
+  TypeCtx(Obj::Mgr& mgr)
+    : mMgr(mgr)
+  {
+  }
+
+  TypeCtx(const TypeCtx&) = delete;
+  TypeCtx& operator=(const TypeCtx&) = delete;
+
+  /// 指向 sub 的指针，qual 是指针本身的限定
+  PointerType* pointer(TypeExpr* sub, Type::Qual qual = Type::Qual::kNone)
+  {
+    auto& slot = mPointers[{ sub, std::uint32_t(qual) }];
+    if (slot == nullptr) {
+      slot = &mMgr.make<PointerType>();
+      slot->sub = sub;
+      slot->qual = qual;
+    }
+    return slot;
+  }
+
+  /// 元素为 sub 的数组，len 为 ArrayType::kUnLen 表示长度未知
+  ArrayType* array(TypeExpr* sub, std::uint32_t len)
+  {
+    auto& slot = mArrays[{ sub, len }];
+    if (slot == nullptr) {
+      slot = &mMgr.make<ArrayType>();
+      slot->sub = sub;
+      slot->len = len;
+    }
+    return slot;
+  }
+
+  /// 返回 sub 的函数，形参类型为 params
+  FunctionType* function(TypeExpr* sub, std::vector<Type> params)
+  {
+    auto hash = combine(std::hash<const void*>()(sub), params.size());
+    for (auto&& i : params) {
+      hash = combine(hash, std::hash<const void*>()(i.texp));
+      hash = combine(hash, std::size_t(i.spec) << 8 | std::size_t(i.qual));
+    }
+
+    // 同一哈希值下逐个比较，形参列表只存一份，就在节点里
+    auto [begin, end] = mFunctions.equal_range(hash);
+    for (auto iter = begin; iter != end; ++iter) {
+      if (iter->second->sub == sub && iter->second->params == params)
+        return iter->second;
+    }
+
+    auto& ret = mMgr.make<FunctionType>();
+    ret.sub = sub;
+    ret.params = std::move(params);
+    mFunctions.emplace(hash, &ret);
+    return &ret;
+  }
+
+private:
+  Obj::Mgr& mMgr;
+
+  /// 指针和数组的键：内层类型加上限定或长度
+  struct Key
+  {
+    TypeExpr* mSub;
+    std::uint32_t mExtra;
+
+    bool operator==(const Key& other) const
+    {
+      return mSub == other.mSub && mExtra == other.mExtra;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return combine(std::hash<const void*>()(key.mSub), key.mExtra);
+    }
+  };
+
+  std::unordered_map<Key, PointerType*, KeyHash> mPointers;
+  std::unordered_map<Key, ArrayType*, KeyHash> mArrays;
+  std::unordered_multimap<std::size_t, FunctionType*> mFunctions;
+
+  static std::size_t combine(std::size_t seed, std::size_t value)
+  {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+  }
+};
+
+} // namespace asg
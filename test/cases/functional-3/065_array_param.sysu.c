@@ -0,0 +1,30 @@
+#include <sysy/sylib.h>
+int sum(int a[], int n) {
+	int i = 0, s = 0;
+	while (i < n) {
+		s = s + a[i];
+		i = i + 1;
+	}
+	return s;
+}
+
+int trace(int m[][3], int n) {
+	int i = 0, s = 0;
+	while (i < n) {
+		s = s + m[i][i];
+		i = i + 1;
+	}
+	return s;
+}
+
+int main () {
+	int a[5] = {3, 1, 4, 1, 5};
+	int m[3][3] = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+	putint(sum(a, 5));
+	putch(10);
+	putint(trace(m, 3));
+	putch(10);
+	putint(sum(m[2], 3));
+	putch(10);
+	return 0;
+}